@@ -8,41 +8,62 @@
 #include <esp_lcd_panel_interface.h>
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_vendor.h>
+#include <esp_lcd_ili9488.h>
+#include <esp_lcd_ili9488_color.h>
 #include <esp_lcd_panel_ops.h>
 #include <esp_lcd_panel_commands.h>
 #include <esp_log.h>
 #include <esp_rom_gpio.h>
+#include <esp_rom_sys.h>
+#include <esp_attr.h>
 #include <esp_check.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <assert.h>
+#include <inttypes.h>
 #include <memory.h>
+#include <sdkconfig.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <sys/cdefs.h>
+#include <sys/param.h>
 
 static const char *TAG = "ili9488";
 
+// The performance counters can be compiled out via CONFIG_ILI9488_ENABLE_STATS,
+// in which case the values passed to the macros below are not used.
+#if CONFIG_ILI9488_ENABLE_STATS
+#define ILI9488_STATS_TIME() esp_timer_get_time()
+#define ILI9488_STATS_ADD(ili9488, field, value) \
+    ((ili9488)->stats.field += (value))
+#define ILI9488_STATS_MAX(ili9488, field, value) \
+    ((ili9488)->stats.field = MAX((ili9488)->stats.field, (value)))
+#else
+#define ILI9488_STATS_TIME() 0
+#define ILI9488_STATS_ADD(ili9488, field, value) ((void)(value))
+#define ILI9488_STATS_MAX(ili9488, field, value) ((void)(value))
+#endif
+
+// Trace points are recorded into a ring buffer shared by all panels when
+// CONFIG_ILI9488_ENABLE_TRACE is enabled, otherwise they are compiled out.
+#if CONFIG_ILI9488_ENABLE_TRACE
+#define ILI9488_TRACE(ili9488, event, phase, value) \
+    panel_ili9488_trace((ili9488)->trace_id, (event), (phase), (value))
+#else
+#define ILI9488_TRACE(ili9488, event, phase, value) ((void)(value))
+#endif
+
 typedef struct
 {
     uint8_t cmd;
     uint8_t data[16];
     uint8_t data_bytes;
+    uint8_t delay_ms;
 } lcd_init_cmd_t;
 
-typedef struct
-{
-    esp_lcd_panel_t base;
-    esp_lcd_panel_io_handle_t io;
-    int reset_gpio_num;
-    bool reset_level;
-    int x_gap;
-    int y_gap;
-    uint8_t memory_access_control;
-    uint8_t color_mode;
-    size_t buffer_size;
-    uint8_t *color_buffer;
-    bool ips;
-} ili9488_panel_t;
-
 enum ili9488_constants
 {
     ILI9488_INTRFC_MODE_CTL = 0xB0,
@@ -61,6 +82,7 @@ enum ili9488_constants
 
     ILI9488_COLOR_MODE_16BIT = 0x55,
     ILI9488_COLOR_MODE_18BIT = 0x66,
+    ILI9488_COLOR_MODE_3BIT = 0x11,
 
     ILI9488_INTERFACE_MODE_USE_SDO = 0x00,
     ILI9488_INTERFACE_MODE_IGNORE_SDO = 0x80,
@@ -70,416 +92,3209 @@ enum ili9488_constants
     ILI9488_WRITE_MODE_BCTRL_DD_ON = 0x28,
     ILI9488_FRAME_RATE_60HZ = 0xA0,
 
-    ILI9488_INIT_LENGTH_MASK = 0x1F,
-    ILI9488_INIT_DONE_FLAG = 0xFF
-};
+    ILI9488_TEAR_EFFECT_VBLANK_ONLY = 0x00,
+    // Maximum time to wait for the TE signal, two frames at 60Hz.
+    ILI9488_TEAR_EFFECT_TIMEOUT_MS = 34,
+    // Draws smaller than this are sent without waiting for the TE signal
+    // when te_sync_min_pixels is zero, a quarter of the screen.
+    ILI9488_TEAR_EFFECT_DEFAULT_MIN_PIXELS = (320 * 480) / 4,
 
-static esp_err_t panel_ili9488_del(esp_lcd_panel_t *panel)
-{
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    // The panel scans 480 visible lines plus the default front and back
+    // porch of two lines each, at 60Hz this is roughly 34us per line.
+    ILI9488_VISIBLE_SCANLINES = 480,
+    ILI9488_TOTAL_SCANLINES = 484,
+    ILI9488_SCANLINE_PERIOD_US = 34,
+    ILI9488_SCANLINE_MASK = 0x3FF,
+    ILI9488_SCANLINE_MAX_POLLS = 3,
 
-    if (ili9488->reset_gpio_num >= 0)
-    {
-        gpio_reset_pin(ili9488->reset_gpio_num);
-    }
+    ILI9488_INIT_LENGTH_MASK = 0x1F,
+    ILI9488_INIT_DONE_FLAG = 0xFF,
 
-    if (ili9488->color_buffer != NULL)
-    {
-        heap_caps_free(ili9488->color_buffer);
-    }
+    // Minimum timings from the datasheet: the reset pulse must be at least
+    // 10us, commands can be sent 5ms after reset, Sleep Out can only be sent
+    // 120ms after reset and the next command 5ms after Sleep Out.
+    ILI9488_RESET_PULSE_US = 10,
+    ILI9488_RESET_DELAY_US = 5000,
+    ILI9488_SLEEP_OUT_AFTER_RESET_US = 120000,
+    ILI9488_SLEEP_OUT_DELAY_US = 5000,
 
-    ESP_LOGI(TAG, "del ili9488 panel @%p", ili9488);
-    free(ili9488);
-    return ESP_OK;
-}
+    // Time given to the display to recover after DISPON / DISPOFF before any
+    // command other than a frame memory write is sent.
+    ILI9488_DISP_ON_OFF_DELAY_US = 100000,
 
-static esp_err_t panel_ili9488_reset(esp_lcd_panel_t *panel)
-{
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    esp_lcd_panel_io_handle_t io = ili9488->io;
+    ILI9488_STARTUP_DONE = 0,
+    ILI9488_STARTUP_SLEEP_OUT,
+    ILI9488_STARTUP_DISPLAY_ON,
 
-    if (ili9488->reset_gpio_num >= 0)
-    {
-        ESP_LOGI(TAG, "Setting GPIO:%d to %d", ili9488->reset_gpio_num,
-                 ili9488->reset_level);
-        // perform hardware reset
-        gpio_set_level(ili9488->reset_gpio_num, ili9488->reset_level);
-        vTaskDelay(pdMS_TO_TICKS(10));
-        ESP_LOGI(TAG, "Setting GPIO:%d to %d", ili9488->reset_gpio_num,
-                 !ili9488->reset_level);
-        gpio_set_level(ili9488->reset_gpio_num, !ili9488->reset_level);
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
-    else
-    {
-        ESP_LOGI(TAG, "Sending SW_RESET to display");
-        esp_lcd_panel_io_tx_param(io, LCD_CMD_SWRESET, NULL, 0);
-        vTaskDelay(pdMS_TO_TICKS(20));
-    }
+    ILI9488_MAX_COLOR_BUFFERS = 4,
 
-    return ESP_OK;
-}
+    // Number of rectangles which are reordered and merged together by
+    // esp_lcd_ili9488_draw_bitmaps, larger batches are handled in chunks.
+    ILI9488_MAX_BATCH_RECTS = 32,
 
-static esp_err_t panel_ili9488_init(esp_lcd_panel_t *panel)
-{
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    esp_lcd_panel_io_handle_t io = ili9488->io;
-
-    lcd_init_cmd_t ili9488_init_default[] =
-    {
-        { ILI9488_POSITIVE_GAMMA_CTL,
-            { 0x00, 0x03, 0x09, 0x08, 0x16,
-            0x0A, 0x3F, 0x78, 0x4C, 0x09,
-            0x0A, 0x08, 0x16, 0x1A, 0x0F },
-            15
-        },
-        { ILI9488_NEGATIVE_GAMMA_CTL,
-            { 0x00, 0x16, 0x19, 0x03, 0x0F,
-            0x05, 0x32, 0x45, 0x46, 0x04,
-            0x0E, 0x0D, 0x35, 0x37, 0x0F},
-            15
-        },
-        { ILI9488_POWER_CTL_ONE, { 0x17, 0x15 }, 2 },
-        { ILI9488_POWER_CTL_TWO, { 0x41 }, 1 },
-        { ILI9488_VCOM_CTL, { 0x00, 0x12, 0x80 }, 3 },
-        { LCD_CMD_MADCTL, { ili9488->memory_access_control }, 1 },
-        { LCD_CMD_COLMOD, { ili9488->color_mode }, 1 },
-        { ILI9488_INTRFC_MODE_CTL, { ILI9488_INTERFACE_MODE_USE_SDO }, 1 },
-        { ILI9488_FRAME_RATE_NORMAL_CTL, { ILI9488_FRAME_RATE_60HZ }, 1 },
-        { ILI9488_INVERSION_CTL, { 0x02 }, 1 },
-        { ILI9488_FUNCTION_CTL, { 0x02, 0x02, 0x3B }, 3},
-        { ILI9488_ENTRY_MODE_CTL, { 0xC6 }, 1 },
-        { ILI9488_ADJUST_CTL_THREE, { 0xA9, 0x51, 0x2C, 0x02 }, 4 },
-        { LCD_CMD_NOP, { 0 }, ILI9488_INIT_DONE_FLAG },
-    };
+    // Number of pixels held by the pattern buffer used for solid fills, one
+    // row of 320 pixels (960 bytes in 18-bit color mode). A full screen fill
+    // takes 480 transfers which are kept in flight by the transaction queue
+    // of the panel IO.
+    ILI9488_FILL_PATTERN_PIXELS = 320,
 
-    lcd_init_cmd_t ili9488_init_ips[] =
-    {
-        { ILI9488_POWER_CTL_ONE, { 0x0F, 0x0F }, 2 },
-        { ILI9488_POWER_CTL_TWO, { 0x41 }, 1 },
-        { ILI9488_POWER_CTL_THREE, { 0x22 }, 1 },
-        { ILI9488_VCOM_CTL, { 0x00, 0x53, 0x80 }, 3 },
-        { LCD_CMD_MADCTL, { ili9488->memory_access_control }, 1 },
-        { LCD_CMD_COLMOD, { ili9488->color_mode }, 1 },
-        { ILI9488_FRAME_RATE_NORMAL_CTL, { ILI9488_FRAME_RATE_60HZ }, 1 },
-        { ILI9488_INVERSION_CTL, { 0x02 }, 1 },
-        { ILI9488_FUNCTION_CTL, { 0x02, 0x22, 0x3B }, 3 },
-        { ILI9488_ENTRY_MODE_CTL, { 0xC6 }, 1 },
-        { ILI9488_ADJUST_CTL_THREE, { 0xA9, 0x51, 0x2C, 0x82 }, 4 },
-        { ILI9488_POSITIVE_GAMMA_CTL, { 0x00, 0x08, 0x0C, 0x02, 0x0E, 0x04, 0x30, 0x45, 0x47, 0x04, 0x0C, 0x0A, 0x2E, 0x34, 0x0F }, 15 },
-        { ILI9488_NEGATIVE_GAMMA_CTL, { 0x00, 0x11, 0x0D, 0x01, 0x0F, 0x05, 0x39, 0x36, 0x51, 0x06, 0x0F, 0x0D, 0x33, 0x37, 0x0F }, 15 },
-        { ILI9488_NORMAL_BLACK_CTL, { 0 }, 0 },
-        { LCD_CMD_NOP, { 0 }, ILI9488_INIT_DONE_FLAG },
-    };
+    // Number of completed draws which can be awaiting their color transfers
+    // when draw done callbacks are in use.
+    ILI9488_MAX_PENDING_DRAWS = 8,
 
-    const lcd_init_cmd_t *init_cmds = ili9488->ips ? ili9488_init_ips : ili9488_init_default;
+    // Defaults used by esp_lcd_ili9488_start_draw_task when no configuration
+    // is provided.
+    ILI9488_DRAW_TASK_QUEUE_SIZE = 16,
+    ILI9488_DRAW_TASK_STACK_SIZE = 4096,
+    ILI9488_DRAW_TASK_PRIORITY = 5,
 
-    ESP_LOGI(TAG, "Initializing ILI9488");
-    int cmd = 0;
-    while ( init_cmds[cmd].data_bytes != ILI9488_INIT_DONE_FLAG )
-    {
-        ESP_LOGD(TAG, "Sending CMD: %02x, len: %d", init_cmds[cmd].cmd,
-                 init_cmds[cmd].data_bytes & ILI9488_INIT_LENGTH_MASK);
-        esp_lcd_panel_io_tx_param(
-            io, init_cmds[cmd].cmd, init_cmds[cmd].data,
-            init_cmds[cmd].data_bytes & ILI9488_INIT_LENGTH_MASK);
-        cmd++;
-    }
+    // Requests passed to the draw task. Besides the draws all functions which
+    // send commands or change the panel state are executed by the draw task.
+    ILI9488_DRAW_REQUEST_BITMAP = 0,
+    ILI9488_DRAW_REQUEST_BITMAP_WITH_CB,
+    ILI9488_DRAW_REQUEST_BITMAP_ASYNC,
+    ILI9488_DRAW_REQUEST_RGB666,
+    ILI9488_DRAW_REQUEST_BITMAPS,
+    ILI9488_DRAW_REQUEST_FILL,
+    ILI9488_DRAW_REQUEST_WAIT_IDLE,
+    ILI9488_DRAW_REQUEST_RESET,
+    ILI9488_DRAW_REQUEST_INIT,
+    ILI9488_DRAW_REQUEST_INVERT_COLOR,
+    ILI9488_DRAW_REQUEST_MIRROR,
+    ILI9488_DRAW_REQUEST_SWAP_XY,
+    ILI9488_DRAW_REQUEST_SET_GAP,
+    ILI9488_DRAW_REQUEST_DISP_ON_OFF,
+    ILI9488_DRAW_REQUEST_SCROLL_AREA,
+    ILI9488_DRAW_REQUEST_SCROLL,
+    ILI9488_DRAW_REQUEST_PARTIAL_AREA,
+    ILI9488_DRAW_REQUEST_PARTIAL_MODE,
+    ILI9488_DRAW_REQUEST_DRAW_DONE_CB,
+    ILI9488_DRAW_REQUEST_STOP,
 
-    // Take the display out of sleep mode.
-    esp_lcd_panel_io_tx_param(io, LCD_CMD_SLPOUT, NULL, 0);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // How panel_ili9488_write_pixels starts sending the color data.
+    ILI9488_WRITE_START = 0,
+    ILI9488_WRITE_START_UNSYNCED,
+    ILI9488_WRITE_CONTINUE,
 
-    // LovyanGFX exits idle mode before enabling the panel. Keep that sequence
-    // here to match the known-good IPS init path more closely.
-    esp_lcd_panel_io_tx_param(io, LCD_CMD_IDMOFF, NULL, 0);
+    // Size of the frame memory and of the tiles used to detect changes when
+    // the shadow framebuffer or tile hashes are enabled. In 18-bit color mode
+    // only the upper six bits of each byte are used, pixels in the shadow
+    // framebuffer which have not been written are set to a value that never
+    // matches. A tile hash of zero is used for tiles with unknown content.
+    ILI9488_FRAME_WIDTH = 320,
+    ILI9488_FRAME_HEIGHT = 480,
+    ILI9488_TILE_SIZE = 16,
+    ILI9488_TILE_COUNT = (ILI9488_FRAME_WIDTH / ILI9488_TILE_SIZE) *
+                         (ILI9488_FRAME_HEIGHT / ILI9488_TILE_SIZE),
+    ILI9488_RGB666_MASK = 0xFC,
+    ILI9488_SHADOW_UNKNOWN = 0xFF,
+    ILI9488_TILE_HASH_UNKNOWN = 0
+};
 
-    // Turn on the display.
-    esp_lcd_panel_io_tx_param(io, LCD_CMD_DISPON, NULL, 0);
-    vTaskDelay(pdMS_TO_TICKS(100));
+// Events recorded by the trace points, the phases use the Chrome trace event
+// format: a begin / end pair for durations and instant events.
+enum ili9488_trace_events
+{
+    ILI9488_TRACE_DRAW = 0,
+    ILI9488_TRACE_SET_WINDOW,
+    ILI9488_TRACE_CONVERT,
+    ILI9488_TRACE_TX_QUEUED,
+    ILI9488_TRACE_TX_DONE,
+    ILI9488_TRACE_INIT,
+    ILI9488_TRACE_RESET,
+    ILI9488_TRACE_STARTUP,
+    ILI9488_TRACE_DISP_ON_OFF,
 
-    ESP_LOGI(TAG, "Initialization complete");
+    ILI9488_TRACE_BEGIN = 'B',
+    ILI9488_TRACE_END = 'E',
+    ILI9488_TRACE_INSTANT = 'i'
+};
 
-    return ESP_OK;
-}
+typedef struct
+{
+    uint32_t transfer_sequence;
+    esp_lcd_ili9488_draw_done_cb_t callback;
+    void *user_ctx;
+} ili9488_pending_draw_t;
 
-#define SEND_COORDS(start, end, io, cmd)                \
-    esp_lcd_panel_io_tx_param(io, cmd, (uint8_t[]) {    \
-        (start >> 8) & 0xFF,                            \
-        start & 0xFF,                                   \
-        ((end - 1) >> 8) & 0xFF,                        \
-        (end - 1) & 0xFF,                               \
-    }, 4)
+// Hashes of the color data last drawn to a tile. Draws which only cover part
+// of the rows of a tile, such as the horizontal strips drawn by LVGL, split
+// the tile at the first row not covered. The rows above and below the split
+// are hashed separately, split is zero when the tile is hashed as a whole.
+typedef struct
+{
+    uint32_t top;
+    uint32_t bottom;
+    uint8_t split;
+} ili9488_tile_hash_t;
 
-static esp_err_t panel_ili9488_draw_bitmap(
-    esp_lcd_panel_t *panel, int x_start, int y_start, int x_end, int y_end,
-    const void *color_data)
+// Draw submitted to the draw task. When done is set the submitting task waits
+// for the draw to be executed and receives the result via result. Requests
+// which configure the panel pass their arguments in x_start, y_start and
+// x_end.
+typedef struct
 {
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    assert((x_start < x_end) && (y_start < y_end) &&
-            "starting position must be smaller than end position");
-    esp_lcd_panel_io_handle_t io = ili9488->io;
+    uint8_t type;
+    int x_start;
+    int y_start;
+    int x_end;
+    int y_end;
+    const void *color_data;
+    size_t count;
+    uint32_t color;
+    esp_lcd_ili9488_draw_done_cb_t callback;
+    void *user_ctx;
+    SemaphoreHandle_t done;
+    esp_err_t *result;
+} ili9488_draw_request_t;
 
-    x_start += ili9488->x_gap;
-    x_end += ili9488->x_gap;
-    y_start += ili9488->y_gap;
-    y_end += ili9488->y_gap;
+// Entry of the draw queue, sequence is the position the entry can be written
+// at and one more than that once the request has been written.
+typedef struct
+{
+    atomic_uint sequence;
+    ili9488_draw_request_t request;
+} ili9488_draw_slot_t;
 
-    size_t color_data_len = (x_end - x_start) * (y_end - y_start);
+// Color data read by panel_ili9488_write_pixels, the pixels are read from rows
+// of row_pixels pixels which start stride bytes apart and are converted to
+// the display format using convert.
+typedef struct
+{
+    const uint8_t *row;
+    size_t row_offset;
+    size_t row_pixels;
+    size_t stride;
+    size_t bytes_per_pixel;
+    void (*convert)(uint8_t *buf, const void *color_data, size_t pixels);
+} ili9488_color_source_t;
+
+typedef struct
+{
+    esp_lcd_panel_t base;
+    esp_lcd_panel_io_handle_t io;
+    int reset_gpio_num;
+    bool reset_level;
+    int x_gap;
+    int y_gap;
+    uint8_t memory_access_control;
+    uint8_t color_mode;
+    size_t buffer_size;
+    uint8_t *color_buffers[ILI9488_MAX_COLOR_BUFFERS];
+    size_t color_buffer_count;
+    size_t color_buffer_index;
+    // Number of color buffer transfers queued since the last command, the
+    // panel IO waits for these to complete before it sends a command.
+    size_t color_buffers_queued;
+    void (*convert_color)(uint8_t *buf, const void *color_data, size_t pixels);
+    size_t color_data_bytes_per_pixel;
+    uint8_t rgb111_first_pixel;
+    bool ips;
+    int te_gpio_num;
+    bool te_isr_added;
+    size_t te_sync_min_pixels;
+    SemaphoreHandle_t te_semaphore;
+    bool scanline_sync;
+    uint32_t scanline_sync_pclk_hz;
+    size_t scanline_sync_min_pixels;
+    uint8_t *fill_pattern;
+    uint32_t fill_color;
+    uint16_t partial_start_line;
+    uint16_t partial_end_line;
+    bool partial_mode;
+    uint16_t scroll_top_fixed_lines;
+    uint16_t scroll_lines;
+    int window_x_start;
+    int window_x_end;
+    int window_y_start;
+    int window_y_end;
+    bool draw_callbacks;
+    esp_lcd_ili9488_draw_done_cb_t draw_done_cb;
+    void *draw_done_user_ctx;
+    portMUX_TYPE draw_lock;
+    volatile uint32_t transfers_queued;
+    volatile uint32_t transfers_done;
+    ili9488_pending_draw_t pending_draws[ILI9488_MAX_PENDING_DRAWS];
+    size_t pending_draw_head;
+    volatile size_t pending_draw_count;
+    SemaphoreHandle_t idle_semaphore;
+    uint8_t startup_stage;
+    bool startup_in_progress;
+    bool startup_display_on;
+    int64_t startup_begin_us;
+    int64_t startup_deadline_us;
+    uint32_t startup_time_us;
+    int64_t command_deadline_us;
+    uint8_t *shadow;
+    uint8_t *shadow_row;
+    ili9488_tile_hash_t *tile_hashes;
+    int frame_width;
+    int frame_height;
+    esp_lcd_ili9488_stats_t stats;
+    uint8_t trace_id;
+    TaskHandle_t draw_task;
+    ili9488_draw_slot_t *draw_queue;
+    unsigned draw_queue_size;
+    // Count the free and the used slots of the draw queue. A task adding a
+    // request takes a free slot and gives a used one, the draw task does the
+    // opposite when it removes a request.
+    SemaphoreHandle_t draw_queue_space;
+    SemaphoreHandle_t draw_queue_items;
+    atomic_uint draw_queue_head;
+    unsigned draw_queue_tail;
+    bool delete_pending;
+} ili9488_panel_t;
 
-    SEND_COORDS(x_start, x_end, io, LCD_CMD_CASET);
-    SEND_COORDS(y_start, y_end, io, LCD_CMD_RASET);
+#if CONFIG_ILI9488_ENABLE_TRACE
+// Entry of the trace ring buffer, sequence is the index of the event plus one
+// once the entry has been written and zero while it is being written.
+typedef struct
+{
+    atomic_uint sequence;
+    uint32_t timestamp_us;
+    uint32_t value;
+    uint8_t event;
+    uint8_t phase;
+    uint8_t panel;
+} ili9488_trace_entry_t;
 
-    // When the ILI9488 is used in 18-bit color mode we need to convert the
-    // incoming color data from RGB565 (16-bit) to RGB666.
-    //
-    // NOTE: 16-bit color does not work via SPI interface :(
-    if (ili9488->color_mode == ILI9488_COLOR_MODE_18BIT)
-    {
-        uint8_t *buf = ili9488->color_buffer;
-        uint16_t *raw_color_data = (uint16_t *) color_data;
-        for (uint32_t i = 0, pixel_index = 0; i < color_data_len; i++) {
-            buf[pixel_index++] = (uint8_t) (((raw_color_data[i] & 0xF800) >> 8) |
-                                            ((raw_color_data[i] & 0x8000) >> 13));
-            buf[pixel_index++] = (uint8_t) ((raw_color_data[i] & 0x07E0) >> 3);
-            buf[pixel_index++] = (uint8_t) (((raw_color_data[i] & 0x001F) << 3) |
-                                            ((raw_color_data[i] & 0x0010) >> 2));
-        }
+static const char *const ili9488_trace_event_names[] =
+{
+    [ILI9488_TRACE_DRAW] = "draw",
+    [ILI9488_TRACE_SET_WINDOW] = "set_window",
+    [ILI9488_TRACE_CONVERT] = "convert",
+    [ILI9488_TRACE_TX_QUEUED] = "tx_queued",
+    [ILI9488_TRACE_TX_DONE] = "tx_done",
+    [ILI9488_TRACE_INIT] = "init",
+    [ILI9488_TRACE_RESET] = "reset",
+    [ILI9488_TRACE_STARTUP] = "startup",
+    [ILI9488_TRACE_DISP_ON_OFF] = "disp_on_off",
+};
 
-        esp_lcd_panel_io_tx_color(io, LCD_CMD_RAMWR, buf, color_data_len * 3);
-    }
-    else
-    {
-        // 16-bit color we can transmit as-is to the display.
-        esp_lcd_panel_io_tx_color(io, LCD_CMD_RAMWR, color_data, color_data_len * 2);
-    }
+static ili9488_trace_entry_t ili9488_trace_entries[CONFIG_ILI9488_TRACE_BUFFER_SIZE];
+static atomic_uint ili9488_trace_head;
+static atomic_uint ili9488_trace_tail;
+static atomic_uint ili9488_trace_panels;
 
-    return ESP_OK;
+// Records a trace event, this can be called from any task or ISR. Each writer
+// claims its own entry, an entry which is overwritten while being dumped is
+// skipped by esp_lcd_ili9488_dump_trace.
+static void IRAM_ATTR panel_ili9488_trace(
+    uint8_t panel, uint8_t event, uint8_t phase, uint32_t value)
+{
+    unsigned index = atomic_fetch_add_explicit(&ili9488_trace_head, 1,
+                                               memory_order_relaxed);
+    ili9488_trace_entry_t *entry =
+        &ili9488_trace_entries[index % CONFIG_ILI9488_TRACE_BUFFER_SIZE];
+    atomic_store_explicit(&entry->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry->timestamp_us = (uint32_t)esp_timer_get_time();
+    entry->value = value;
+    entry->event = event;
+    entry->phase = phase;
+    entry->panel = panel;
+    atomic_store_explicit(&entry->sequence, index + 1, memory_order_release);
 }
+#endif
 
-#undef SEND_COORDS
+static const lcd_init_cmd_t ili9488_init_default[] =
+{
+    { ILI9488_POSITIVE_GAMMA_CTL,
+        { 0x00, 0x03, 0x09, 0x08, 0x16,
+        0x0A, 0x3F, 0x78, 0x4C, 0x09,
+        0x0A, 0x08, 0x16, 0x1A, 0x0F },
+        15, 0
+    },
+    { ILI9488_NEGATIVE_GAMMA_CTL,
+        { 0x00, 0x16, 0x19, 0x03, 0x0F,
+        0x05, 0x32, 0x45, 0x46, 0x04,
+        0x0E, 0x0D, 0x35, 0x37, 0x0F},
+        15, 0
+    },
+    { ILI9488_POWER_CTL_ONE, { 0x17, 0x15 }, 2, 0 },
+    { ILI9488_POWER_CTL_TWO, { 0x41 }, 1, 0 },
+    { ILI9488_VCOM_CTL, { 0x00, 0x12, 0x80 }, 3, 0 },
+    // MADCTL and COLMOD are sent using the current panel configuration.
+    { LCD_CMD_MADCTL, { 0 }, 1, 0 },
+    { LCD_CMD_COLMOD, { 0 }, 1, 0 },
+    { ILI9488_INTRFC_MODE_CTL, { ILI9488_INTERFACE_MODE_USE_SDO }, 1, 0 },
+    { ILI9488_FRAME_RATE_NORMAL_CTL, { ILI9488_FRAME_RATE_60HZ }, 1, 0 },
+    { ILI9488_INVERSION_CTL, { 0x02 }, 1, 0 },
+    { ILI9488_FUNCTION_CTL, { 0x02, 0x02, 0x3B }, 3, 0 },
+    { ILI9488_ENTRY_MODE_CTL, { 0xC6 }, 1, 0 },
+    { ILI9488_ADJUST_CTL_THREE, { 0xA9, 0x51, 0x2C, 0x02 }, 4, 0 },
+    { LCD_CMD_NOP, { 0 }, ILI9488_INIT_DONE_FLAG, 0 },
+};
 
-static esp_err_t panel_ili9488_invert_color(
-    esp_lcd_panel_t *panel, bool invert_color_data)
+static const lcd_init_cmd_t ili9488_init_ips[] =
 {
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    esp_lcd_panel_io_handle_t io = ili9488->io;
-    
-    if (invert_color_data)
-    {
-        esp_lcd_panel_io_tx_param(io, LCD_CMD_INVON, NULL, 0);
-    }
-    else
+    { ILI9488_POWER_CTL_ONE, { 0x0F, 0x0F }, 2, 0 },
+    { ILI9488_POWER_CTL_TWO, { 0x41 }, 1, 0 },
+    { ILI9488_POWER_CTL_THREE, { 0x22 }, 1, 0 },
+    { ILI9488_VCOM_CTL, { 0x00, 0x53, 0x80 }, 3, 0 },
+    // MADCTL and COLMOD are sent using the current panel configuration.
+    { LCD_CMD_MADCTL, { 0 }, 1, 0 },
+    { LCD_CMD_COLMOD, { 0 }, 1, 0 },
+    { ILI9488_FRAME_RATE_NORMAL_CTL, { ILI9488_FRAME_RATE_60HZ }, 1, 0 },
+    { ILI9488_INVERSION_CTL, { 0x02 }, 1, 0 },
+    { ILI9488_FUNCTION_CTL, { 0x02, 0x22, 0x3B }, 3, 0 },
+    { ILI9488_ENTRY_MODE_CTL, { 0xC6 }, 1, 0 },
+    { ILI9488_ADJUST_CTL_THREE, { 0xA9, 0x51, 0x2C, 0x82 }, 4, 0 },
+    { ILI9488_POSITIVE_GAMMA_CTL, { 0x00, 0x08, 0x0C, 0x02, 0x0E, 0x04, 0x30, 0x45, 0x47, 0x04, 0x0C, 0x0A, 0x2E, 0x34, 0x0F }, 15, 0 },
+    { ILI9488_NEGATIVE_GAMMA_CTL, { 0x00, 0x11, 0x0D, 0x01, 0x0F, 0x05, 0x39, 0x36, 0x51, 0x06, 0x0F, 0x0D, 0x33, 0x37, 0x0F }, 15, 0 },
+    { ILI9488_NORMAL_BLACK_CTL, { 0 }, 0, 0 },
+    { LCD_CMD_NOP, { 0 }, ILI9488_INIT_DONE_FLAG, 0 },
+};
+
+static void panel_ili9488_complete_startup(ili9488_panel_t *ili9488);
+static void panel_ili9488_wait_until(int64_t deadline_us);
+
+// Commands which access the frame memory or only write registers can be sent
+// while the display is still in sleep mode or recovering from DISPON /
+// DISPOFF, all others complete the startup sequence and wait for the display
+// to recover first.
+static bool panel_ili9488_is_sleep_safe_cmd(int lcd_cmd)
+{
+    switch (lcd_cmd)
     {
-        esp_lcd_panel_io_tx_param(io, LCD_CMD_INVOFF, NULL, 0);
+        case LCD_CMD_NOP:
+        case LCD_CMD_CASET:
+        case LCD_CMD_RASET:
+        case LCD_CMD_RAMWR:
+        case LCD_CMD_WRMEMC:
+        case LCD_CMD_MADCTL:
+        case LCD_CMD_COLMOD:
+        case LCD_CMD_INVON:
+        case LCD_CMD_INVOFF:
+        case LCD_CMD_VSCRDEF:
+        case LCD_CMD_VSCSAD:
+        case LCD_CMD_TEON:
+        case LCD_CMD_TEOFF:
+        case LCD_CMD_PTLAR:
+            return true;
+        default:
+            return false;
     }
-    
-    return ESP_OK;
 }
 
-static esp_err_t panel_ili9488_mirror(
-    esp_lcd_panel_t *panel, bool mirror_x, bool mirror_y)
+// All commands and color data are sent to the display via the functions
+// below, this keeps track of the number of bytes sent on the bus and the time
+// spent waiting for the panel IO to accept them.
+static esp_err_t panel_ili9488_tx_param(
+    ili9488_panel_t *ili9488, int lcd_cmd, const void *param, size_t param_size)
 {
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    esp_lcd_panel_io_handle_t io = ili9488->io;
-    if (mirror_x)
-    {
-        ili9488->memory_access_control &= ~LCD_CMD_MX_BIT;
-    }
-    else
+    if (ili9488->startup_stage != ILI9488_STARTUP_DONE &&
+        !ili9488->startup_in_progress && !panel_ili9488_is_sleep_safe_cmd(lcd_cmd))
     {
-        ili9488->memory_access_control |= LCD_CMD_MX_BIT;
+        panel_ili9488_complete_startup(ili9488);
     }
-    if (mirror_y)
+    if (ili9488->command_deadline_us && !panel_ili9488_is_sleep_safe_cmd(lcd_cmd))
     {
-        ili9488->memory_access_control |= LCD_CMD_MY_BIT;
+        panel_ili9488_wait_until(ili9488->command_deadline_us);
+        ili9488->command_deadline_us = 0;
     }
-    else
+    ILI9488_STATS_ADD(ili9488, commands, 1);
+    ILI9488_STATS_ADD(ili9488, parameter_bytes, param_size);
+    int64_t start_us = ILI9488_STATS_TIME();
+    esp_err_t ret =
+        esp_lcd_panel_io_tx_param(ili9488->io, lcd_cmd, param, param_size);
+    ILI9488_STATS_ADD(ili9488, queue_wait_time_us, ILI9488_STATS_TIME() - start_us);
+    if (ret == ESP_OK)
     {
-        ili9488->memory_access_control &= ~LCD_CMD_MY_BIT;
+        ili9488->color_buffers_queued = 0;
     }
-    esp_lcd_panel_io_tx_param(io, LCD_CMD_MADCTL, &ili9488->memory_access_control, 1);
-    return ESP_OK;
+    return ret;
 }
 
-static esp_err_t panel_ili9488_swap_xy(esp_lcd_panel_t *panel, bool swap_axes)
+static esp_err_t panel_ili9488_tx_color(
+    ili9488_panel_t *ili9488, int lcd_cmd, const void *color, size_t color_size)
 {
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    esp_lcd_panel_io_handle_t io = ili9488->io;
-    if (swap_axes)
+    ILI9488_STATS_ADD(ili9488, commands, 1);
+    ILI9488_STATS_ADD(ili9488, color_transfers, 1);
+    ILI9488_STATS_ADD(ili9488, color_bytes, color_size);
+    if (ili9488->draw_callbacks)
     {
-        ili9488->memory_access_control |= LCD_CMD_MV_BIT;
+        portENTER_CRITICAL(&ili9488->draw_lock);
+        ili9488->transfers_queued++;
+        portEXIT_CRITICAL(&ili9488->draw_lock);
     }
-    else
+    int64_t start_us = ILI9488_STATS_TIME();
+    esp_err_t ret =
+        esp_lcd_panel_io_tx_color(ili9488->io, lcd_cmd, color, color_size);
+    ILI9488_STATS_ADD(ili9488, queue_wait_time_us, ILI9488_STATS_TIME() - start_us);
+    if (ret != ESP_OK)
     {
-        ili9488->memory_access_control &= ~LCD_CMD_MV_BIT;
+        if (ili9488->draw_callbacks)
+        {
+            // The transfer was never queued so its completion callback will
+            // not run, take it back out of the count.
+            portENTER_CRITICAL(&ili9488->draw_lock);
+            ili9488->transfers_queued--;
+            bool idle = ili9488->transfers_done == ili9488->transfers_queued;
+            portEXIT_CRITICAL(&ili9488->draw_lock);
+            if (idle)
+            {
+                xSemaphoreGive(ili9488->idle_semaphore);
+            }
+        }
+        return ret;
     }
-    esp_lcd_panel_io_tx_param(io, LCD_CMD_MADCTL, &ili9488->memory_access_control, 1);
-    return ESP_OK;
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_TX_QUEUED, ILI9488_TRACE_INSTANT,
+                  color_size);
+    return ret;
 }
 
-static esp_err_t panel_ili9488_set_gap(
-    esp_lcd_panel_t *panel, int x_gap, int y_gap)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static esp_err_t panel_ili9488_rx_param(
+    ili9488_panel_t *ili9488, int lcd_cmd, void *param, size_t param_size)
 {
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    ili9488->x_gap = x_gap;
-    ili9488->y_gap = y_gap;
-    return ESP_OK;
+    ILI9488_STATS_ADD(ili9488, commands, 1);
+    int64_t start_us = ILI9488_STATS_TIME();
+    esp_err_t ret =
+        esp_lcd_panel_io_rx_param(ili9488->io, lcd_cmd, param, param_size);
+    ILI9488_STATS_ADD(ili9488, queue_wait_time_us, ILI9488_STATS_TIME() - start_us);
+    return ret;
 }
+#endif
 
-static esp_err_t panel_ili9488_disp_on_off(esp_lcd_panel_t *panel, bool on_off)
+// Forgets the last address window sent to the display so that the next draw
+// sends both CASET and RASET.
+static void panel_ili9488_invalidate_window(ili9488_panel_t *ili9488)
 {
-    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
-    esp_lcd_panel_io_handle_t io = ili9488->io;
+    ili9488->window_x_start = -1;
+    ili9488->window_x_end = -1;
+    ili9488->window_y_start = -1;
+    ili9488->window_y_end = -1;
+}
 
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
-    // In ESP-IDF v4.x the API used false for "on" and true for "off"
-    // invert the logic to be consistent with IDF v5.x.
-    on_off = !on_off;
-#endif
+static void panel_ili9488_clear_tile_hash(ili9488_tile_hash_t *tile_hash)
+{
+    tile_hash->top = ILI9488_TILE_HASH_UNKNOWN;
+    tile_hash->bottom = ILI9488_TILE_HASH_UNKNOWN;
+    tile_hash->split = 0;
+}
 
-    if (on_off)
+// Marks the content of all tiles as unknown, they will be sent to the display
+// by the next draw covering them.
+static void panel_ili9488_invalidate_tiles(ili9488_panel_t *ili9488)
+{
+    if (ili9488->shadow != NULL)
     {
-        esp_lcd_panel_io_tx_param(io, LCD_CMD_DISPON, NULL, 0);
+        memset(ili9488->shadow, ILI9488_SHADOW_UNKNOWN,
+               ILI9488_FRAME_WIDTH * ILI9488_FRAME_HEIGHT * 3);
     }
-    else
+    if (ili9488->tile_hashes != NULL)
     {
-        esp_lcd_panel_io_tx_param(io, LCD_CMD_DISPOFF, NULL, 0);
+        memset(ili9488->tile_hashes, ILI9488_TILE_HASH_UNKNOWN,
+               ILI9488_TILE_COUNT * sizeof(ili9488_tile_hash_t));
     }
-
-    // give time for the ILI9488 to recover after an on/off command
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    return ESP_OK;
 }
 
-static esp_err_t esp_lcd_new_panel_ili9488_internal(
-    const esp_lcd_panel_io_handle_t io,
-    const esp_lcd_panel_dev_config_t *panel_dev_config,
-    const size_t buffer_size,
-    bool ips,
-    esp_lcd_panel_handle_t *ret_panel)
+// Returns the number of bytes sent to the display for the given number of
+// pixels in the current color mode.
+static size_t panel_ili9488_bus_bytes(ili9488_panel_t *ili9488, size_t pixels)
 {
-    esp_err_t ret = ESP_OK;
-    ili9488_panel_t *ili9488 = NULL;
-    ESP_GOTO_ON_FALSE(io && panel_dev_config && ret_panel, ESP_ERR_INVALID_ARG,
-                      err, TAG, "invalid argument");
-    ili9488 = (ili9488_panel_t *)(calloc(1, sizeof(ili9488_panel_t)));
-    ESP_GOTO_ON_FALSE(ili9488, ESP_ERR_NO_MEM, err, TAG, "no mem for ili9488 panel");
+    switch (ili9488->color_mode)
+    {
+        case ILI9488_COLOR_MODE_16BIT:
+            return pixels * 2;
+        case ILI9488_COLOR_MODE_3BIT:
+            return (pixels + 1) / 2;
+        default:
+            return pixels * 3;
+    }
+}
 
-    if (panel_dev_config->reset_gpio_num >= 0)
+static void panel_ili9488_delay_us(uint32_t delay_us)
+{
+    const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+    if (delay_us >= tick_us)
     {
-        gpio_config_t cfg;
-        memset(&cfg, 0, sizeof(gpio_config_t));
-        esp_rom_gpio_pad_select_gpio(panel_dev_config->reset_gpio_num);
-        cfg.pin_bit_mask = BIT64(panel_dev_config->reset_gpio_num);
-        cfg.mode = GPIO_MODE_OUTPUT;
-        ESP_GOTO_ON_ERROR(gpio_config(&cfg), err, TAG,
-                          "configure GPIO for RESET line failed");
+        vTaskDelay(delay_us / tick_us);
+        delay_us %= tick_us;
     }
+    esp_rom_delay_us(delay_us);
+}
 
-    ili9488->ips = ips;
+// Waits until the given esp_timer time has been reached.
+static void panel_ili9488_wait_until(int64_t deadline_us)
+{
+    int64_t remaining_us = deadline_us - esp_timer_get_time();
+    if (remaining_us > 0)
+    {
+        panel_ili9488_delay_us(remaining_us);
+    }
+}
 
-    if (panel_dev_config->bits_per_pixel == 16)
+// Sends the remainder of the startup sequence deferred by init, waiting for
+// the minimum delays required by the display where needed.
+static void panel_ili9488_complete_startup(ili9488_panel_t *ili9488)
+{
+    if (ili9488->startup_stage == ILI9488_STARTUP_DONE)
     {
-        ili9488->color_mode = ILI9488_COLOR_MODE_16BIT;
+        return;
     }
-    else
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_STARTUP, ILI9488_TRACE_BEGIN, 0);
+    ili9488->startup_in_progress = true;
+    while (ili9488->startup_stage != ILI9488_STARTUP_DONE)
     {
-        ESP_GOTO_ON_FALSE(buffer_size > 0, ESP_ERR_INVALID_ARG, err, TAG,
-                          "Color conversion buffer size must be specified");
-        ili9488->color_mode = ILI9488_COLOR_MODE_18BIT;
+        panel_ili9488_wait_until(ili9488->startup_deadline_us);
+        if (ili9488->startup_stage == ILI9488_STARTUP_SLEEP_OUT)
+        {
+            // Take the display out of sleep mode.
+            panel_ili9488_tx_param(ili9488, LCD_CMD_SLPOUT, NULL, 0);
+            ili9488->startup_deadline_us =
+                esp_timer_get_time() + ILI9488_SLEEP_OUT_DELAY_US;
+            ili9488->startup_stage = ILI9488_STARTUP_DISPLAY_ON;
+        }
+        else
+        {
+            // LovyanGFX exits idle mode before enabling the panel. Keep that
+            // sequence here to match the known-good IPS init path more
+            // closely.
+            panel_ili9488_tx_param(ili9488, LCD_CMD_IDMOFF, NULL, 0);
+            if (ili9488->startup_display_on)
+            {
+                panel_ili9488_tx_param(ili9488, LCD_CMD_DISPON, NULL, 0);
+            }
+            ili9488->startup_stage = ILI9488_STARTUP_DONE;
+            ESP_LOGI(TAG, "Startup complete after %" PRId64 "us",
+                     esp_timer_get_time() - ili9488->startup_begin_us);
+        }
+    }
+    ili9488->startup_in_progress = false;
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_STARTUP, ILI9488_TRACE_END, 0);
+}
 
-        // Allocate DMA buffer for color conversions
-        ili9488->color_buffer =
-            (uint8_t *)heap_caps_malloc(buffer_size * 3, MALLOC_CAP_DMA);
-        ESP_GOTO_ON_FALSE(ili9488->color_buffer, ESP_ERR_NO_MEM, err, TAG,
-                          "Failed to allocate DMA color conversion buffer");
+// Called after color data has been queued, completes the startup sequence
+// and records the time it took for the first frame to be shown.
+static void panel_ili9488_frame_queued(ili9488_panel_t *ili9488)
+{
+    panel_ili9488_complete_startup(ili9488);
+    if (ili9488->startup_time_us == 0 && ili9488->startup_begin_us != 0 &&
+        ili9488->startup_display_on)
+    {
+        ili9488->startup_time_us =
+            esp_timer_get_time() - ili9488->startup_begin_us;
     }
+}
 
-    ili9488->memory_access_control = LCD_CMD_MX_BIT | LCD_CMD_BGR_BIT;
+// Called when a draw is submitted, returns the time passed to
+// panel_ili9488_count_draws.
+static int64_t panel_ili9488_begin_draw(ili9488_panel_t *ili9488)
+{
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_DRAW, ILI9488_TRACE_BEGIN, 0);
+    return ILI9488_STATS_TIME();
+}
 
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(6, 0, 0)
-    switch (panel_dev_config->color_space)
+// Counts completed draws, start_us is the time the draw was submitted.
+static void panel_ili9488_count_draws(
+    ili9488_panel_t *ili9488, size_t draws, int64_t start_us)
+{
+    ILI9488_STATS_ADD(ili9488, draws, draws);
+    ILI9488_STATS_MAX(ili9488, max_draw_latency_us,
+                      (uint32_t)(ILI9488_STATS_TIME() - start_us));
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_DRAW, ILI9488_TRACE_END, draws);
+}
+
+// Called instead of panel_ili9488_count_draws when a draw failed, ends the
+// trace event without counting the draw.
+static void panel_ili9488_abort_draw(ili9488_panel_t *ili9488)
+{
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_DRAW, ILI9488_TRACE_END, 0);
+}
+
+static void IRAM_ATTR panel_ili9488_te_isr(void *arg)
+{
+    ili9488_panel_t *ili9488 = (ili9488_panel_t *)arg;
+    BaseType_t high_task_wakeup = pdFALSE;
+    xSemaphoreGiveFromISR(ili9488->te_semaphore, &high_task_wakeup);
+    if (high_task_wakeup == pdTRUE)
     {
-        case ESP_LCD_COLOR_SPACE_RGB:
-            ESP_LOGI(TAG, "Configuring for RGB color order");
-            ili9488->memory_access_control &= ~LCD_CMD_BGR_BIT;
-            break;
-        case ESP_LCD_COLOR_SPACE_BGR:
+        portYIELD_FROM_ISR();
+    }
+}
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+// Called by the panel IO when a color transfer has completed, invokes the
+// callbacks of all draws whose transfers have completed.
+static bool IRAM_ATTR panel_ili9488_color_trans_done(
+    esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata,
+    void *user_ctx)
+{
+    ili9488_panel_t *ili9488 = (ili9488_panel_t *)user_ctx;
+    bool need_yield = false;
+
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_TX_DONE, ILI9488_TRACE_INSTANT,
+                  ili9488->transfers_done + 1);
+    portENTER_CRITICAL_ISR(&ili9488->draw_lock);
+    ili9488->transfers_done++;
+    while (ili9488->pending_draw_count > 0)
+    {
+        ili9488_pending_draw_t *draw =
+            &ili9488->pending_draws[ili9488->pending_draw_head];
+        if ((int32_t)(ili9488->transfers_done - draw->transfer_sequence) < 0)
+        {
+            break;
+        }
+        esp_lcd_ili9488_draw_done_cb_t callback = draw->callback;
+        void *draw_user_ctx = draw->user_ctx;
+        ili9488->pending_draw_head =
+            (ili9488->pending_draw_head + 1) % ILI9488_MAX_PENDING_DRAWS;
+        ili9488->pending_draw_count--;
+        portEXIT_CRITICAL_ISR(&ili9488->draw_lock);
+        if (callback(&ili9488->base, draw_user_ctx))
+        {
+            need_yield = true;
+        }
+        portENTER_CRITICAL_ISR(&ili9488->draw_lock);
+    }
+    bool idle = ili9488->transfers_done == ili9488->transfers_queued;
+    portEXIT_CRITICAL_ISR(&ili9488->draw_lock);
+
+    if (idle)
+    {
+        BaseType_t high_task_wakeup = pdFALSE;
+        xSemaphoreGiveFromISR(ili9488->idle_semaphore, &high_task_wakeup);
+        if (high_task_wakeup == pdTRUE)
+        {
+            need_yield = true;
+        }
+    }
+
+    return need_yield;
+}
+#endif
+
+// Records that all color transfers of a draw have been queued, the callback
+// will be invoked once they have completed. When all transfers have already
+// completed the callback is invoked immediately.
+static void panel_ili9488_draw_queued(
+    ili9488_panel_t *ili9488, esp_lcd_ili9488_draw_done_cb_t callback,
+    void *user_ctx)
+{
+    panel_ili9488_frame_queued(ili9488);
+
+    if (!ili9488->draw_callbacks || callback == NULL)
+    {
+        return;
+    }
+
+    // Only one color transfer is in flight at any time, when there is no room
+    // to track this draw the NOP will wait for it to complete.
+    if (ili9488->pending_draw_count == ILI9488_MAX_PENDING_DRAWS)
+    {
+        panel_ili9488_tx_param(ili9488, LCD_CMD_NOP, NULL, 0);
+    }
+
+    portENTER_CRITICAL(&ili9488->draw_lock);
+    bool completed = ili9488->transfers_done == ili9488->transfers_queued;
+    if (!completed)
+    {
+        ili9488_pending_draw_t *draw = &ili9488->pending_draws[
+            (ili9488->pending_draw_head + ili9488->pending_draw_count) %
+            ILI9488_MAX_PENDING_DRAWS];
+        draw->transfer_sequence = ili9488->transfers_queued;
+        draw->callback = callback;
+        draw->user_ctx = user_ctx;
+        ili9488->pending_draw_count++;
+    }
+    portEXIT_CRITICAL(&ili9488->draw_lock);
+
+    if (completed)
+    {
+        callback(&ili9488->base, user_ctx);
+    }
+}
+
+// Returns true when the calling task has to pass its draws to the draw task,
+// the draw task itself executes them directly.
+static bool panel_ili9488_use_draw_task(ili9488_panel_t *ili9488)
+{
+    return ili9488->draw_task != NULL &&
+           ili9488->draw_task != xTaskGetCurrentTaskHandle();
+}
+
+// Adds a request to the draw queue, this can be called by any number of tasks
+// concurrently. Returns false when no slot became free within wait ticks.
+static bool panel_ili9488_enqueue_draw(
+    ili9488_panel_t *ili9488, const ili9488_draw_request_t *request,
+    TickType_t wait)
+{
+    // Holding a token guarantees a free slot, the loop below only has to
+    // resolve which task claims which slot.
+    if (xSemaphoreTake(ili9488->draw_queue_space, wait) != pdTRUE)
+    {
+        return false;
+    }
+    unsigned pos =
+        atomic_load_explicit(&ili9488->draw_queue_head, memory_order_relaxed);
+    ili9488_draw_slot_t *slot;
+    for (;;)
+    {
+        slot = &ili9488->draw_queue[pos & (ili9488->draw_queue_size - 1)];
+        unsigned sequence =
+            atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int diff = (int)(sequence - pos);
+        if (diff == 0)
+        {
+            // The slot is free, claim it unless another task was faster.
+            if (atomic_compare_exchange_weak_explicit(
+                    &ili9488->draw_queue_head, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ili9488->draw_queue_head,
+                                       memory_order_relaxed);
+        }
+    }
+    slot->request = *request;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    xSemaphoreGive(ili9488->draw_queue_items);
+    return true;
+}
+
+// Removes the oldest request from the draw queue, only called by the draw
+// task. Returns false when the queue is empty.
+static bool panel_ili9488_dequeue_draw(
+    ili9488_panel_t *ili9488, ili9488_draw_request_t *request)
+{
+    unsigned pos = ili9488->draw_queue_tail;
+    ili9488_draw_slot_t *slot =
+        &ili9488->draw_queue[pos & (ili9488->draw_queue_size - 1)];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != pos + 1)
+    {
+        return false;
+    }
+    *request = slot->request;
+    atomic_store_explicit(&slot->sequence, pos + ili9488->draw_queue_size,
+                          memory_order_release);
+    ili9488->draw_queue_tail = pos + 1;
+    xSemaphoreGive(ili9488->draw_queue_space);
+    return true;
+}
+
+// Passes a request to the draw task and waits for it to be executed.
+static esp_err_t panel_ili9488_submit_and_wait(
+    ili9488_panel_t *ili9488, ili9488_draw_request_t *request)
+{
+    StaticSemaphore_t done_buffer;
+    esp_err_t ret = ESP_OK;
+    request->done = xSemaphoreCreateBinaryStatic(&done_buffer);
+    request->result = &ret;
+    panel_ili9488_enqueue_draw(ili9488, request, portMAX_DELAY);
+    xSemaphoreTake(request->done, portMAX_DELAY);
+    vSemaphoreDelete(request->done);
+    return ret;
+}
+
+static void panel_ili9488_free_draw_queue(ili9488_panel_t *ili9488)
+{
+    free(ili9488->draw_queue);
+    ili9488->draw_queue = NULL;
+    if (ili9488->draw_queue_space != NULL)
+    {
+        vSemaphoreDelete(ili9488->draw_queue_space);
+        ili9488->draw_queue_space = NULL;
+    }
+    if (ili9488->draw_queue_items != NULL)
+    {
+        vSemaphoreDelete(ili9488->draw_queue_items);
+        ili9488->draw_queue_items = NULL;
+    }
+}
+
+// Releases all resources of the panel, the draw task must have been stopped.
+static void panel_ili9488_free(ili9488_panel_t *ili9488)
+{
+    panel_ili9488_free_draw_queue(ili9488);
+
+    if (ili9488->reset_gpio_num >= 0)
+    {
+        gpio_reset_pin(ili9488->reset_gpio_num);
+    }
+
+    if (ili9488->te_isr_added)
+    {
+        gpio_isr_handler_remove(ili9488->te_gpio_num);
+    }
+
+    if (ili9488->te_gpio_num >= 0)
+    {
+        gpio_reset_pin(ili9488->te_gpio_num);
+    }
+
+    if (ili9488->te_semaphore != NULL)
+    {
+        vSemaphoreDelete(ili9488->te_semaphore);
+    }
+
+    if (ili9488->idle_semaphore != NULL)
+    {
+        vSemaphoreDelete(ili9488->idle_semaphore);
+    }
+
+    for (size_t idx = 0; idx < ili9488->color_buffer_count; idx++)
+    {
+        heap_caps_free(ili9488->color_buffers[idx]);
+    }
+
+    if (ili9488->fill_pattern != NULL)
+    {
+        heap_caps_free(ili9488->fill_pattern);
+    }
+
+    if (ili9488->shadow != NULL)
+    {
+        heap_caps_free(ili9488->shadow);
+        free(ili9488->shadow_row);
+    }
+    free(ili9488->tile_hashes);
+
+    ESP_LOGI(TAG, "del ili9488 panel @%p", ili9488);
+    free(ili9488);
+}
+
+static esp_err_t panel_ili9488_del(esp_lcd_panel_t *panel)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+
+    if (ili9488->draw_task != NULL)
+    {
+        if (ili9488->draw_task == xTaskGetCurrentTaskHandle())
+        {
+            // Called by a draw done callback on the draw task, which cannot
+            // wait for itself. The request being executed still uses the
+            // panel, the draw task releases it and stops once it completes.
+            ili9488->delete_pending = true;
+            return ESP_OK;
+        }
+
+        // Draws submitted before the panel is deleted are executed before the
+        // draw task stops.
+        ili9488_draw_request_t request = { .type = ILI9488_DRAW_REQUEST_STOP };
+        panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+    panel_ili9488_free(ili9488);
+    return ESP_OK;
+}
+
+static esp_err_t panel_ili9488_reset(esp_lcd_panel_t *panel)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_RESET
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_RESET, ILI9488_TRACE_BEGIN, 0);
+
+    // Any pending startup sequence or recovery delay is discarded by the
+    // reset.
+    ili9488->startup_stage = ILI9488_STARTUP_DONE;
+    ili9488->command_deadline_us = 0;
+
+    if (ili9488->reset_gpio_num >= 0)
+    {
+        ESP_LOGI(TAG, "Setting GPIO:%d to %d", ili9488->reset_gpio_num,
+                 ili9488->reset_level);
+        // perform hardware reset
+        gpio_set_level(ili9488->reset_gpio_num, ili9488->reset_level);
+        esp_rom_delay_us(ILI9488_RESET_PULSE_US);
+        ESP_LOGI(TAG, "Setting GPIO:%d to %d", ili9488->reset_gpio_num,
+                 !ili9488->reset_level);
+        gpio_set_level(ili9488->reset_gpio_num, !ili9488->reset_level);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Sending SW_RESET to display");
+        panel_ili9488_tx_param(ili9488, LCD_CMD_SWRESET, NULL, 0);
+    }
+    panel_ili9488_invalidate_window(ili9488);
+    panel_ili9488_invalidate_tiles(ili9488);
+
+    // The display is in sleep mode after the reset, init waits for the reset
+    // to complete before sending commands.
+    ili9488->startup_begin_us = esp_timer_get_time();
+    ili9488->startup_deadline_us =
+        ili9488->startup_begin_us + ILI9488_RESET_DELAY_US;
+
+    // The reset restores the default scrolling area, it needs to be defined
+    // again before scrolling.
+    ili9488->scroll_top_fixed_lines = 0;
+    ili9488->scroll_lines = 0;
+
+    // The display is back in normal mode with the default partial area.
+    ili9488->partial_start_line = 0;
+    ili9488->partial_end_line = 0;
+    ili9488->partial_mode = false;
+
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_RESET, ILI9488_TRACE_END, 0);
+    return ESP_OK;
+}
+
+static esp_err_t panel_ili9488_init(esp_lcd_panel_t *panel)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_INIT
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    const lcd_init_cmd_t *init_cmds = ili9488->ips ? ili9488_init_ips : ili9488_init_default;
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_INIT, ILI9488_TRACE_BEGIN, 0);
+
+    // Without a preceding reset the startup time is measured from here.
+    int64_t reset_us = ili9488->startup_begin_us;
+    if (reset_us == 0)
+    {
+        reset_us = ili9488->startup_begin_us = esp_timer_get_time();
+        ili9488->startup_deadline_us = reset_us;
+    }
+    panel_ili9488_wait_until(ili9488->startup_deadline_us);
+
+    ESP_LOGI(TAG, "Initializing ILI9488");
+    panel_ili9488_invalidate_window(ili9488);
+    int cmd = 0;
+    while ( init_cmds[cmd].data_bytes != ILI9488_INIT_DONE_FLAG )
+    {
+        // The parameters are copied to the stack as the panel IO may not be
+        // able to send them directly from flash.
+        uint8_t data[sizeof(init_cmds[cmd].data)];
+        size_t data_bytes = init_cmds[cmd].data_bytes & ILI9488_INIT_LENGTH_MASK;
+        memcpy(data, init_cmds[cmd].data, data_bytes);
+        if (init_cmds[cmd].cmd == LCD_CMD_MADCTL)
+        {
+            data[0] = ili9488->memory_access_control;
+        }
+        else if (init_cmds[cmd].cmd == LCD_CMD_COLMOD)
+        {
+            data[0] = ili9488->color_mode;
+        }
+        ESP_LOGD(TAG, "Sending CMD: %02x, len: %d", init_cmds[cmd].cmd,
+                 (int)data_bytes);
+        panel_ili9488_tx_param(ili9488, init_cmds[cmd].cmd, data, data_bytes);
+        if (init_cmds[cmd].delay_ms)
+        {
+            vTaskDelay(pdMS_TO_TICKS(init_cmds[cmd].delay_ms));
+        }
+        cmd++;
+    }
+
+    if (ili9488->te_gpio_num >= 0)
+    {
+        // Enable the TE output, it will only signal the vertical blanking
+        // period.
+        panel_ili9488_tx_param(ili9488, LCD_CMD_TEON,
+            (uint8_t[]) { ILI9488_TEAR_EFFECT_VBLANK_ONLY }, 1);
+    }
+
+    // Sleep Out can only be sent 120ms after the reset, rather than waiting
+    // here the remainder of the startup sequence is sent by the first command
+    // which requires it or after the first frame has been queued. This allows
+    // the first frame to be prepared and written to the frame memory while
+    // the display is still starting up.
+    ili9488->startup_stage = ILI9488_STARTUP_SLEEP_OUT;
+    ili9488->startup_display_on = true;
+    ili9488->startup_time_us = 0;
+    ili9488->startup_deadline_us = reset_us + ILI9488_SLEEP_OUT_AFTER_RESET_US;
+
+    ESP_LOGI(TAG, "Initialization complete");
+
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_INIT, ILI9488_TRACE_END, 0);
+    return ESP_OK;
+}
+
+#define SEND_COORDS(start, end, ili9488, cmd)           \
+    panel_ili9488_tx_param(ili9488, cmd, (uint8_t[]) {  \
+        (start >> 8) & 0xFF,                            \
+        start & 0xFF,                                   \
+        ((end - 1) >> 8) & 0xFF,                        \
+        (end - 1) & 0xFF,                               \
+    }, 4)
+
+// Sets the address window of the display. When sending either command fails
+// the window of the display is unknown and the cached window is invalidated.
+static esp_err_t panel_ili9488_set_window(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end)
+{
+    esp_err_t ret = ESP_OK;
+
+    // The display retains the address window between memory writes, only
+    // send the parts which have changed since the last draw.
+    uint32_t commands_sent = 0;
+    if (x_start != ili9488->window_x_start || x_end != ili9488->window_x_end)
+    {
+        ESP_GOTO_ON_ERROR(SEND_COORDS(x_start, x_end, ili9488, LCD_CMD_CASET),
+                          err, TAG, "send CASET failed");
+        ili9488->window_x_start = x_start;
+        ili9488->window_x_end = x_end;
+        commands_sent++;
+    }
+    else
+    {
+        ILI9488_STATS_ADD(ili9488, address_commands_skipped, 1);
+    }
+
+    if (y_start != ili9488->window_y_start || y_end != ili9488->window_y_end)
+    {
+        ESP_GOTO_ON_ERROR(SEND_COORDS(y_start, y_end, ili9488, LCD_CMD_RASET),
+                          err, TAG, "send RASET failed");
+        ili9488->window_y_start = y_start;
+        ili9488->window_y_end = y_end;
+        commands_sent++;
+    }
+    else
+    {
+        ILI9488_STATS_ADD(ili9488, address_commands_skipped, 1);
+    }
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_SET_WINDOW, ILI9488_TRACE_INSTANT,
+                  commands_sent);
+    return ESP_OK;
+
+err:
+    panel_ili9488_invalidate_window(ili9488);
+    return ret;
+}
+
+#undef SEND_COORDS
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+
+// Waits until the write of the address window can start without the display
+// scan passing through the lines it covers before the write has completed.
+// The scan moves faster than the data can be sent, so the write is started
+// right after the scan has left the area ("beam racing").
+static void panel_ili9488_wait_for_scanline(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end)
+{
+    // Determine the panel lines being updated, with MV set the x-axis is
+    // mapped to the panel lines and MY reverses the order of the lines.
+    int first_line = y_start;
+    int last_line = y_end;
+    if (ili9488->memory_access_control & LCD_CMD_MV_BIT)
+    {
+        first_line = x_start;
+        last_line = x_end;
+    }
+    if (ili9488->memory_access_control & LCD_CMD_MY_BIT)
+    {
+        int line = first_line;
+        first_line = ILI9488_VISIBLE_SCANLINES - last_line;
+        last_line = ILI9488_VISIBLE_SCANLINES - line;
+    }
+    first_line = MAX(first_line, 0);
+    last_line = MIN(last_line, ILI9488_VISIBLE_SCANLINES);
+
+    // Estimate how many lines the scan advances while the data is sent.
+    size_t bytes =
+        panel_ili9488_bus_bytes(ili9488, (x_end - x_start) * (y_end - y_start));
+    uint64_t write_us =
+        (uint64_t)bytes * 8 * 1000000 / ili9488->scanline_sync_pclk_hz;
+    int write_lines = (write_us / ILI9488_SCANLINE_PERIOD_US) + 1;
+    if (last_line - first_line + write_lines >= ILI9488_TOTAL_SCANLINES)
+    {
+        ESP_LOGD(TAG, "Draw is too large to avoid the scan position");
+        return;
+    }
+
+    for (int poll = 0; poll < ILI9488_SCANLINE_MAX_POLLS; poll++)
+    {
+        // The first byte received is a dummy read.
+        uint8_t data[3] = { 0 };
+        if (panel_ili9488_rx_param(ili9488, LCD_CMD_GDCAN, data, sizeof(data)) != ESP_OK)
+        {
+            return;
+        }
+        int line = ((data[1] << 8) | data[2]) & ILI9488_SCANLINE_MASK;
+        int lines_until_start =
+            (first_line - line + ILI9488_TOTAL_SCANLINES) % ILI9488_TOTAL_SCANLINES;
+        bool in_area = line >= first_line && line < last_line;
+        if (!in_area && lines_until_start > write_lines)
+        {
+            return;
+        }
+
+        // Wait for the scan to leave the area.
+        int lines_until_end =
+            (last_line - line + ILI9488_TOTAL_SCANLINES) % ILI9488_TOTAL_SCANLINES;
+        panel_ili9488_delay_us((lines_until_end + 1) * ILI9488_SCANLINE_PERIOD_US);
+    }
+    ESP_LOGD(TAG, "Timeout waiting for scanline");
+}
+#endif
+
+// Sets the address window for the next RAMWR and, when TE or scanline
+// synchronization is enabled and the area is large enough, waits until the
+// update can be sent without tearing.
+static esp_err_t panel_ili9488_prepare_write(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end)
+{
+    ESP_RETURN_ON_ERROR(
+        panel_ili9488_set_window(ili9488, x_start, y_start, x_end, y_end),
+        TAG, "set address window failed");
+
+    // The display does not refresh until the startup sequence has completed,
+    // there is nothing to synchronize with.
+    if (ili9488->startup_stage != ILI9488_STARTUP_DONE)
+    {
+        return ESP_OK;
+    }
+
+    size_t pixels = (x_end - x_start) * (y_end - y_start);
+    if (ili9488->te_semaphore != NULL && pixels >= ili9488->te_sync_min_pixels)
+    {
+        // Discard any previously recorded TE signal and wait for a new one.
+        xSemaphoreTake(ili9488->te_semaphore, 0);
+        if (xSemaphoreTake(ili9488->te_semaphore,
+                pdMS_TO_TICKS(ILI9488_TEAR_EFFECT_TIMEOUT_MS)) != pdTRUE)
+        {
+            ESP_LOGD(TAG, "Timeout waiting for TE signal");
+        }
+    }
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    else if (ili9488->scanline_sync && pixels >= ili9488->scanline_sync_min_pixels)
+    {
+        panel_ili9488_wait_for_scanline(ili9488, x_start, y_start, x_end, y_end);
+    }
+#endif
+    return ESP_OK;
+}
+
+// Returns a source for color_data as passed to draw_bitmap, all pixels are
+// read as a single row.
+static ili9488_color_source_t panel_ili9488_color_source(
+    ili9488_panel_t *ili9488, const void *color_data, size_t color_data_len)
+{
+    ili9488_color_source_t source =
+    {
+        .row = (const uint8_t *)color_data,
+        .row_offset = 0,
+        .row_pixels = color_data_len,
+        .stride = color_data_len * ili9488->color_data_bytes_per_pixel,
+        .bytes_per_pixel = ili9488->color_data_bytes_per_pixel,
+        .convert = ili9488->convert_color,
+    };
+    return source;
+}
+
+// Skips the given number of pixels of the source, the pixels may only span
+// multiple rows when the rows are contiguous.
+static void panel_ili9488_advance_source(
+    ili9488_color_source_t *source, size_t pixels)
+{
+    source->row_offset += pixels;
+    if (source->row_offset >= source->row_pixels)
+    {
+        source->row +=
+            (source->row_offset / source->row_pixels) * source->stride;
+        source->row_offset %= source->row_pixels;
+    }
+}
+
+static void panel_ili9488_copy_rgb666(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    memcpy(buf, color_data, pixels * 3);
+}
+
+// Converts the next pixels of the source into buf. In 3-bit color mode the
+// source must consist of a single row.
+static void panel_ili9488_read_source(
+    ili9488_panel_t *ili9488, ili9488_color_source_t *source, uint8_t *buf,
+    size_t pixels)
+{
+    // Copying from the shadow framebuffer is not counted as a conversion.
+    if (source->convert != panel_ili9488_copy_rgb666)
+    {
+        ILI9488_STATS_ADD(ili9488, pixels_converted, pixels);
+    }
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_CONVERT, ILI9488_TRACE_BEGIN, pixels);
+    int64_t start_us = ILI9488_STATS_TIME();
+    while (pixels > 0)
+    {
+        size_t count = MIN(pixels, source->row_pixels - source->row_offset);
+        source->convert(
+            buf, source->row + source->row_offset * source->bytes_per_pixel,
+            count);
+        buf += panel_ili9488_bus_bytes(ili9488, count);
+        pixels -= count;
+        panel_ili9488_advance_source(source, count);
+    }
+    ILI9488_STATS_ADD(ili9488, conversion_time_us, ILI9488_STATS_TIME() - start_us);
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_CONVERT, ILI9488_TRACE_END, 0);
+}
+
+static esp_err_t panel_ili9488_start_write(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end,
+    int write_mode)
+{
+    if (write_mode == ILI9488_WRITE_START_UNSYNCED)
+    {
+        return panel_ili9488_set_window(ili9488, x_start, y_start, x_end, y_end);
+    }
+    return panel_ili9488_prepare_write(ili9488, x_start, y_start, x_end, y_end);
+}
+
+// Converts the color data when using 18-bit or 3-bit color mode and sends it
+// to the display. Unless write_mode is ILI9488_WRITE_CONTINUE a new memory
+// write is started using the provided address window, otherwise the color
+// data is appended to the previous memory write via RAMWRC (Memory Write
+// Continue). ILI9488_WRITE_START_UNSYNCED skips the TE / scanline
+// synchronization.
+static esp_err_t panel_ili9488_write_pixels(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end,
+    ili9488_color_source_t *source, size_t color_data_len, int write_mode)
+{
+    bool continue_write = write_mode == ILI9488_WRITE_CONTINUE;
+
+    // When the ILI9488 is used in 18-bit color mode we need to convert the
+    // incoming color data from RGB565 (16-bit), RGB888 (24-bit) or XRGB8888
+    // (32-bit) to RGB666, in 3-bit color mode RGB565 is packed to two pixels
+    // per byte.
+    //
+    // NOTE: 16-bit color does not work via SPI interface :(
+    if (ili9488->color_mode != ILI9488_COLOR_MODE_16BIT)
+    {
+        ESP_RETURN_ON_FALSE(ili9488->color_buffer_count > 0,
+                            ESP_ERR_INVALID_STATE, TAG,
+                            "No color conversion buffer has been allocated");
+
+        // In 3-bit color mode the display receives two pixels per byte. When
+        // the address window has an odd number of pixels the display wraps
+        // around to the start of the window for the last pixel, which is set
+        // to the first pixel of the window so that it remains unchanged.
+        if (ili9488->color_mode == ILI9488_COLOR_MODE_3BIT && !continue_write)
+        {
+            uint32_t first_pixel;
+            source->convert((uint8_t *)&first_pixel, source->row, 1);
+            ili9488->rgb111_first_pixel = ((uint8_t *)&first_pixel)[0] >> 3;
+        }
+
+        // The color data is converted and transmitted in slices of up to
+        // buffer_size pixels, the first slice is sent using RAMWR and all
+        // following slices continue where the previous one ended via RAMWRC.
+        int lcd_cmd = continue_write ? LCD_CMD_WRMEMC : LCD_CMD_RAMWR;
+        while (color_data_len > 0)
+        {
+            size_t pixels = MIN(color_data_len, ili9488->buffer_size);
+            uint8_t *buf = ili9488->color_buffers[ili9488->color_buffer_index];
+            ILI9488_STATS_MAX(ili9488, max_buffer_pixels, pixels);
+            ili9488->color_buffer_index =
+                (ili9488->color_buffer_index + 1) % ili9488->color_buffer_count;
+
+            // panel_ili9488_tx_color only queues the color data, the IO
+            // layer will wait for all queued transfers to complete before it
+            // sends the next command. The SPI panel IO also waits before
+            // sending the command of a color transfer but the i80 panel IO
+            // does not, so a buffer is only refilled while its previous
+            // transfer may still be in flight after a command has been sent.
+            // A single buffer can be reused after the CASET / RASET of a new
+            // memory write, otherwise a NOP is sent to wait for the transfer.
+            if (ili9488->color_buffer_count == 1 && lcd_cmd == LCD_CMD_RAMWR)
+            {
+                ESP_RETURN_ON_ERROR(
+                    panel_ili9488_start_write(ili9488, x_start, y_start,
+                                              x_end, y_end, write_mode),
+                    TAG, "start memory write failed");
+            }
+            if (ili9488->color_buffers_queued >= ili9488->color_buffer_count)
+            {
+                ESP_RETURN_ON_ERROR(
+                    panel_ili9488_tx_param(ili9488, LCD_CMD_NOP, NULL, 0),
+                    TAG, "send NOP failed");
+            }
+
+            panel_ili9488_read_source(ili9488, source, buf, pixels);
+            if (ili9488->color_mode == ILI9488_COLOR_MODE_3BIT && (pixels & 1))
+            {
+                buf[pixels / 2] |= ili9488->rgb111_first_pixel;
+            }
+
+            if (ili9488->color_buffer_count > 1 && lcd_cmd == LCD_CMD_RAMWR)
+            {
+                ESP_RETURN_ON_ERROR(
+                    panel_ili9488_start_write(ili9488, x_start, y_start,
+                                              x_end, y_end, write_mode),
+                    TAG, "start memory write failed");
+            }
+
+            ESP_RETURN_ON_ERROR(
+                panel_ili9488_tx_color(ili9488, lcd_cmd, buf,
+                                       panel_ili9488_bus_bytes(ili9488, pixels)),
+                TAG, "send color data failed");
+            ili9488->color_buffers_queued++;
+
+            lcd_cmd = LCD_CMD_WRMEMC;
+            color_data_len -= pixels;
+        }
+    }
+    else
+    {
+        if (!continue_write)
+        {
+            ESP_RETURN_ON_ERROR(
+                panel_ili9488_start_write(ili9488, x_start, y_start, x_end,
+                                          y_end, write_mode),
+                TAG, "start memory write failed");
+        }
+
+        // 16-bit color we can transmit as-is to the display, as a single
+        // transfer when the rows of the source are contiguous (such as a run
+        // spanning the full width of the bitmap) and otherwise using one
+        // transfer per row.
+        int lcd_cmd = continue_write ? LCD_CMD_WRMEMC : LCD_CMD_RAMWR;
+        const bool contiguous = source->stride == source->row_pixels * 2;
+        while (color_data_len > 0)
+        {
+            size_t pixels = contiguous ? color_data_len :
+                MIN(color_data_len, source->row_pixels - source->row_offset);
+            ESP_RETURN_ON_ERROR(
+                panel_ili9488_tx_color(ili9488, lcd_cmd,
+                                       source->row + source->row_offset * 2,
+                                       pixels * 2),
+                TAG, "send color data failed");
+            panel_ili9488_advance_source(source, pixels);
+            lcd_cmd = LCD_CMD_WRMEMC;
+            color_data_len -= pixels;
+        }
+    }
+
+    return ESP_OK;
+}
+
+static bool panel_ili9488_frame_contains(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end)
+{
+    return x_start >= 0 && y_start >= 0 && x_end <= ili9488->frame_width &&
+           y_end <= ili9488->frame_height;
+}
+
+// Marks the content of an area as unknown, used when a draw has failed and
+// the display may only have received part of it. The hashes of all tiles
+// overlapping the area are cleared.
+static void panel_ili9488_invalidate_area(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end)
+{
+    if (ili9488->shadow == NULL && ili9488->tile_hashes == NULL)
+    {
+        return;
+    }
+    if (!panel_ili9488_frame_contains(ili9488, x_start, y_start, x_end, y_end))
+    {
+        panel_ili9488_invalidate_tiles(ili9488);
+        return;
+    }
+    if (ili9488->tile_hashes != NULL)
+    {
+        const int tiles_per_row = ili9488->frame_width / ILI9488_TILE_SIZE;
+        for (int tile_y = y_start / ILI9488_TILE_SIZE;
+             tile_y <= (y_end - 1) / ILI9488_TILE_SIZE; tile_y++)
+        {
+            for (int tile_x = x_start / ILI9488_TILE_SIZE;
+                 tile_x <= (x_end - 1) / ILI9488_TILE_SIZE; tile_x++)
+            {
+                panel_ili9488_clear_tile_hash(
+                    &ili9488->tile_hashes[tile_y * tiles_per_row + tile_x]);
+            }
+        }
+    }
+    if (ili9488->shadow != NULL)
+    {
+        const size_t shadow_stride = ili9488->frame_width * 3;
+        for (int y = y_start; y < y_end; y++)
+        {
+            memset(ili9488->shadow + y * shadow_stride + x_start * 3,
+                   ILI9488_SHADOW_UNKNOWN, (x_end - x_start) * 3);
+        }
+    }
+}
+
+// Sends the changed tiles of a row of tiles, changed has one bit per tile
+// starting with the tile containing x_start. Adjacent changed tiles are sent
+// using a single address window and only the first window of a draw is
+// synchronized with the display scan. The band source describes the color
+// data of the row of tiles starting at x_start.
+static esp_err_t panel_ili9488_write_tiles(
+    ili9488_panel_t *ili9488, const ili9488_color_source_t *band, int x_start,
+    int x_end, int band_start, int band_end, uint32_t changed, int *write_mode,
+    size_t *pixels_sent)
+{
+    const int first_tile = x_start / ILI9488_TILE_SIZE;
+    while (changed)
+    {
+        int run_start = __builtin_ctzl(changed);
+        int run_end = run_start;
+        while (changed & (1UL << run_end))
+        {
+            changed &= ~(1UL << run_end);
+            run_end++;
+        }
+        int window_x_start =
+            MAX(x_start, (first_tile + run_start) * ILI9488_TILE_SIZE);
+        int window_x_end =
+            MIN(x_end, (first_tile + run_end) * ILI9488_TILE_SIZE);
+        size_t pixels = (window_x_end - window_x_start) * (band_end - band_start);
+        ili9488_color_source_t source = *band;
+        source.row += (window_x_start - x_start) * band->bytes_per_pixel;
+        source.row_pixels = window_x_end - window_x_start;
+        ESP_RETURN_ON_ERROR(
+            panel_ili9488_write_pixels(ili9488, window_x_start, band_start,
+                                       window_x_end, band_end, &source,
+                                       pixels, *write_mode),
+            TAG, "send tiles failed");
+        *write_mode = ILI9488_WRITE_START_UNSYNCED;
+        *pixels_sent += pixels;
+    }
+    return ESP_OK;
+}
+
+// Draws using the shadow framebuffer. The color data is converted row by row
+// and compared to the shadow framebuffer, only the tiles which have changed
+// are sent to the display.
+static esp_err_t panel_ili9488_draw_shadow(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end,
+    const void *color_data)
+{
+    const size_t width = x_end - x_start;
+    const size_t row_bytes = width * 3;
+    const size_t shadow_stride = ili9488->frame_width * 3;
+    const int first_tile = x_start / ILI9488_TILE_SIZE;
+    const int tiles = (x_end - 1) / ILI9488_TILE_SIZE - first_tile + 1;
+    const uint32_t all_tiles = (1UL << tiles) - 1;
+    const uint8_t *raw_color_data = (const uint8_t *)color_data;
+    esp_err_t ret = ESP_OK;
+    int write_mode = ILI9488_WRITE_START;
+    size_t pixels_sent = 0;
+
+    for (int band_start = y_start, band_end; band_start < y_end;
+         band_start = band_end)
+    {
+        band_end = MIN(y_end, (band_start / ILI9488_TILE_SIZE + 1) *
+                              ILI9488_TILE_SIZE);
+        uint32_t changed = 0;
+        for (int y = band_start; y < band_end; y++)
+        {
+            uint8_t *shadow = ili9488->shadow + y * shadow_stride + x_start * 3;
+            ILI9488_TRACE(ili9488, ILI9488_TRACE_CONVERT, ILI9488_TRACE_BEGIN,
+                          width);
+            int64_t start_us = ILI9488_STATS_TIME();
+            ili9488->convert_color(ili9488->shadow_row, raw_color_data, width);
+            raw_color_data += width * ili9488->color_data_bytes_per_pixel;
+            ILI9488_STATS_ADD(ili9488, conversion_time_us,
+                              ILI9488_STATS_TIME() - start_us);
+            ILI9488_TRACE(ili9488, ILI9488_TRACE_CONVERT, ILI9488_TRACE_END, 0);
+            ILI9488_STATS_ADD(ili9488, pixels_converted, width);
+
+            // RGB888 and XRGB8888 color data is passed through without
+            // clearing the bits unused by the display.
+            if (ili9488->color_data_bytes_per_pixel > 2)
+            {
+                for (size_t idx = 0; idx < row_bytes; idx++)
+                {
+                    ili9488->shadow_row[idx] &= ILI9488_RGB666_MASK;
+                }
+            }
+
+            if (changed != all_tiles &&
+                memcmp(ili9488->shadow_row, shadow, row_bytes) != 0)
+            {
+                for (int tile = 0; tile < tiles; tile++)
+                {
+                    int start = MAX(x_start, (first_tile + tile) *
+                                             ILI9488_TILE_SIZE);
+                    int end = MIN(x_end, (first_tile + tile + 1) *
+                                         ILI9488_TILE_SIZE);
+                    size_t offset = (start - x_start) * 3;
+                    if (!(changed & (1UL << tile)) &&
+                        memcmp(ili9488->shadow_row + offset, shadow + offset,
+                               (end - start) * 3) != 0)
+                    {
+                        changed |= 1UL << tile;
+                    }
+                }
+            }
+            memcpy(shadow, ili9488->shadow_row, row_bytes);
+        }
+
+        ili9488_color_source_t band =
+        {
+            .row = ili9488->shadow + band_start * shadow_stride + x_start * 3,
+            .row_offset = 0,
+            .row_pixels = width,
+            .stride = shadow_stride,
+            .bytes_per_pixel = 3,
+            .convert = panel_ili9488_copy_rgb666,
+        };
+        ESP_GOTO_ON_ERROR(
+            panel_ili9488_write_tiles(ili9488, &band, x_start, x_end,
+                                      band_start, band_end, changed,
+                                      &write_mode, &pixels_sent),
+            err, TAG, "send changed tiles failed");
+    }
+    ILI9488_STATS_ADD(ili9488, unchanged_pixels_skipped,
+                      width * (y_end - y_start) - pixels_sent);
+
+    return ESP_OK;
+
+err:
+    // The shadow framebuffer already contains the new color data, which may
+    // not have reached the display.
+    panel_ili9488_invalidate_area(ili9488, x_start, y_start, x_end, y_end);
+    return ret;
+}
+
+// Computes a 32-bit hash of rows of a tile of color data, each row consists
+// of row_bytes bytes and the rows start stride bytes apart.
+static uint32_t panel_ili9488_hash_tile(
+    const uint8_t *color_data, size_t row_bytes, size_t stride, int rows)
+{
+    uint32_t hash = 0x811C9DC5;
+    for (int row = 0; row < rows; row++)
+    {
+        for (size_t offset = 0; offset < row_bytes; offset += sizeof(uint32_t))
+        {
+            uint32_t word;
+            memcpy(&word, color_data + offset, sizeof(word));
+            hash = (((hash << 5) | (hash >> 27)) ^ word) * 0x9E3779B1;
+        }
+        color_data += stride;
+    }
+    hash ^= hash >> 16;
+    return hash != ILI9488_TILE_HASH_UNKNOWN ? hash : 1;
+}
+
+// Updates the hashes of a tile for a draw covering rows first_row up to
+// end_row of it, color_data points to the first row drawn. Returns true when
+// the rows have to be sent to the display.
+static bool panel_ili9488_update_tile_hash(
+    ili9488_tile_hash_t *tile_hash, const uint8_t *color_data,
+    size_t row_bytes, size_t stride, int first_row, int end_row)
+{
+    const int split = tile_hash->split;
+    if (first_row == 0 && end_row == ILI9488_TILE_SIZE)
+    {
+        uint32_t top = split ?
+            panel_ili9488_hash_tile(color_data, row_bytes, stride, split) :
+            ILI9488_TILE_HASH_UNKNOWN;
+        uint32_t bottom = panel_ili9488_hash_tile(
+            color_data + split * stride, row_bytes, stride,
+            ILI9488_TILE_SIZE - split);
+        bool changed = top != tile_hash->top || bottom != tile_hash->bottom;
+        tile_hash->top = top;
+        tile_hash->bottom = bottom;
+        return changed;
+    }
+
+    uint32_t hash = panel_ili9488_hash_tile(color_data, row_bytes, stride,
+                                            end_row - first_row);
+    if (first_row == 0 && end_row == split)
+    {
+        bool changed = hash != tile_hash->top;
+        tile_hash->top = hash;
+        return changed;
+    }
+    if (split != 0 && first_row == split && end_row == ILI9488_TILE_SIZE)
+    {
+        bool changed = hash != tile_hash->bottom;
+        tile_hash->bottom = hash;
+        return changed;
+    }
+
+    // The rows drawn do not match the current split, split the tile where the
+    // draw ends so that the next draw of the same rows can be compared.
+    panel_ili9488_clear_tile_hash(tile_hash);
+    if (first_row == 0)
+    {
+        tile_hash->split = end_row;
+        tile_hash->top = hash;
+    }
+    else if (end_row == ILI9488_TILE_SIZE)
+    {
+        tile_hash->split = first_row;
+        tile_hash->bottom = hash;
+    }
+    return true;
+}
+
+// Draws using the tile hashes. The hash of the rows of each tile covered by
+// the draw is compared with the hash of the color data previously drawn to
+// them, unchanged tiles are neither converted nor sent to the display. Tiles
+// only partially covered by the width of the draw are always sent.
+static esp_err_t panel_ili9488_draw_hashed(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end,
+    const void *color_data)
+{
+    const size_t width = x_end - x_start;
+    const size_t bytes_per_pixel = ili9488->color_mode == ILI9488_COLOR_MODE_16BIT ?
+        2 : ili9488->color_data_bytes_per_pixel;
+    const size_t stride = width * bytes_per_pixel;
+    const int first_tile = x_start / ILI9488_TILE_SIZE;
+    const int tiles = (x_end - 1) / ILI9488_TILE_SIZE - first_tile + 1;
+    const int tiles_per_row = ili9488->frame_width / ILI9488_TILE_SIZE;
+    esp_err_t ret = ESP_OK;
+    int write_mode = ILI9488_WRITE_START;
+    size_t pixels_sent = 0;
+
+    for (int band_start = y_start, band_end; band_start < y_end;
+         band_start = band_end)
+    {
+        band_end = MIN(y_end, (band_start / ILI9488_TILE_SIZE + 1) *
+                              ILI9488_TILE_SIZE);
+        const uint8_t *band_data = (const uint8_t *)color_data +
+                                   (band_start - y_start) * stride;
+        ili9488_tile_hash_t *hashes = ili9488->tile_hashes +
+            (band_start / ILI9488_TILE_SIZE) * tiles_per_row + first_tile;
+        const int first_row = band_start % ILI9488_TILE_SIZE;
+        const int end_row = first_row + (band_end - band_start);
+        uint32_t changed = 0;
+        for (int tile = 0; tile < tiles; tile++)
+        {
+            int start = (first_tile + tile) * ILI9488_TILE_SIZE;
+            if (start < x_start || start + ILI9488_TILE_SIZE > x_end)
+            {
+                panel_ili9488_clear_tile_hash(&hashes[tile]);
+                changed |= 1UL << tile;
+                continue;
+            }
+            if (panel_ili9488_update_tile_hash(
+                    &hashes[tile],
+                    band_data + (start - x_start) * bytes_per_pixel,
+                    ILI9488_TILE_SIZE * bytes_per_pixel, stride, first_row,
+                    end_row))
+            {
+                changed |= 1UL << tile;
+            }
+        }
+
+        ili9488_color_source_t band =
+        {
+            .row = band_data,
+            .row_offset = 0,
+            .row_pixels = width,
+            .stride = stride,
+            .bytes_per_pixel = bytes_per_pixel,
+            .convert = ili9488->convert_color,
+        };
+        ESP_GOTO_ON_ERROR(
+            panel_ili9488_write_tiles(ili9488, &band, x_start, x_end,
+                                      band_start, band_end, changed,
+                                      &write_mode, &pixels_sent),
+            err, TAG, "send changed tiles failed");
+    }
+    ILI9488_STATS_ADD(ili9488, unchanged_pixels_skipped,
+                      width * (y_end - y_start) - pixels_sent);
+
+    return ESP_OK;
+
+err:
+    // The tile hashes have already been updated for color data which may not
+    // have reached the display.
+    panel_ili9488_invalidate_area(ili9488, x_start, y_start, x_end, y_end);
+    return ret;
+}
+
+// Updates the tiles of an area written without using panel_ili9488_draw. The
+// shadow framebuffer is updated with pixels in the display format, stride is
+// the number of bytes from one row of pixels to the next and a stride of zero
+// repeats the first row for all rows of the area. The hashes of all tiles
+// overlapping the area are cleared.
+static void panel_ili9488_update_tiles(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end,
+    const uint8_t *rgb666, size_t stride)
+{
+    if (ili9488->shadow == NULL ||
+        !panel_ili9488_frame_contains(ili9488, x_start, y_start, x_end, y_end))
+    {
+        panel_ili9488_invalidate_area(ili9488, x_start, y_start, x_end, y_end);
+        return;
+    }
+    const size_t shadow_stride = ili9488->frame_width * 3;
+    for (int y = y_start; y < y_end; y++)
+    {
+        memcpy(ili9488->shadow + y * shadow_stride + x_start * 3, rgb666,
+               (x_end - x_start) * 3);
+        rgb666 += stride;
+    }
+}
+
+static esp_err_t panel_ili9488_draw(
+    ili9488_panel_t *ili9488, int x_start, int y_start, int x_end, int y_end,
+    const void *color_data)
+{
+    assert((x_start < x_end) && (y_start < y_end) &&
+            "starting position must be smaller than end position");
+
+    x_start += ili9488->x_gap;
+    x_end += ili9488->x_gap;
+    y_start += ili9488->y_gap;
+    y_end += ili9488->y_gap;
+
+    if (ili9488->shadow != NULL)
+    {
+        if (panel_ili9488_frame_contains(ili9488, x_start, y_start, x_end,
+                                          y_end))
+        {
+            return panel_ili9488_draw_shadow(ili9488, x_start, y_start, x_end,
+                                             y_end, color_data);
+        }
+        panel_ili9488_invalidate_tiles(ili9488);
+    }
+    else if (ili9488->tile_hashes != NULL)
+    {
+        if (panel_ili9488_frame_contains(ili9488, x_start, y_start, x_end,
+                                         y_end))
+        {
+            return panel_ili9488_draw_hashed(ili9488, x_start, y_start, x_end,
+                                             y_end, color_data);
+        }
+        panel_ili9488_invalidate_tiles(ili9488);
+    }
+
+    size_t color_data_len = (x_end - x_start) * (y_end - y_start);
+    ili9488_color_source_t source =
+        panel_ili9488_color_source(ili9488, color_data, color_data_len);
+
+    return panel_ili9488_write_pixels(ili9488, x_start, y_start, x_end, y_end,
+                                      &source, color_data_len,
+                                      ILI9488_WRITE_START);
+}
+
+static esp_err_t panel_ili9488_draw_bitmap(
+    esp_lcd_panel_t *panel, int x_start, int y_start, int x_end, int y_end,
+    const void *color_data)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_BITMAP,
+            .x_start = x_start, .y_start = y_start,
+            .x_end = x_end, .y_end = y_end,
+            .color_data = color_data
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = panel_ili9488_begin_draw(ili9488);
+
+    ESP_GOTO_ON_ERROR(
+        panel_ili9488_draw(ili9488, x_start, y_start, x_end, y_end, color_data),
+        err, TAG, "draw failed");
+    panel_ili9488_count_draws(ili9488, 1, start_us);
+    panel_ili9488_draw_queued(ili9488, ili9488->draw_done_cb,
+                              ili9488->draw_done_user_ctx);
+    return ESP_OK;
+
+err:
+    panel_ili9488_abort_draw(ili9488);
+    return ret;
+}
+
+static esp_err_t panel_ili9488_invert_color(
+    esp_lcd_panel_t *panel, bool invert_color_data)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_INVERT_COLOR,
+            .x_start = invert_color_data
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+    if (invert_color_data)
+    {
+        panel_ili9488_tx_param(ili9488, LCD_CMD_INVON, NULL, 0);
+    }
+    else
+    {
+        panel_ili9488_tx_param(ili9488, LCD_CMD_INVOFF, NULL, 0);
+    }
+    
+    return ESP_OK;
+}
+
+static esp_err_t panel_ili9488_mirror(
+    esp_lcd_panel_t *panel, bool mirror_x, bool mirror_y)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_MIRROR,
+            .x_start = mirror_x, .y_start = mirror_y
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    if (mirror_x)
+    {
+        ili9488->memory_access_control &= ~LCD_CMD_MX_BIT;
+    }
+    else
+    {
+        ili9488->memory_access_control |= LCD_CMD_MX_BIT;
+    }
+    if (mirror_y)
+    {
+        ili9488->memory_access_control |= LCD_CMD_MY_BIT;
+    }
+    else
+    {
+        ili9488->memory_access_control &= ~LCD_CMD_MY_BIT;
+    }
+    panel_ili9488_tx_param(ili9488, LCD_CMD_MADCTL, &ili9488->memory_access_control, 1);
+    panel_ili9488_invalidate_window(ili9488);
+    panel_ili9488_invalidate_tiles(ili9488);
+    return ESP_OK;
+}
+
+static esp_err_t panel_ili9488_swap_xy(esp_lcd_panel_t *panel, bool swap_axes)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_SWAP_XY,
+            .x_start = swap_axes
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    if (swap_axes)
+    {
+        ili9488->memory_access_control |= LCD_CMD_MV_BIT;
+    }
+    else
+    {
+        ili9488->memory_access_control &= ~LCD_CMD_MV_BIT;
+    }
+    panel_ili9488_tx_param(ili9488, LCD_CMD_MADCTL, &ili9488->memory_access_control, 1);
+    panel_ili9488_invalidate_window(ili9488);
+
+    // The shadow framebuffer and tile hashes use the same coordinates as the
+    // address window, with swapped axes the rows are 480 pixels long.
+    ili9488->frame_width = swap_axes ? ILI9488_FRAME_HEIGHT : ILI9488_FRAME_WIDTH;
+    ili9488->frame_height = swap_axes ? ILI9488_FRAME_WIDTH : ILI9488_FRAME_HEIGHT;
+    panel_ili9488_invalidate_tiles(ili9488);
+    return ESP_OK;
+}
+
+static esp_err_t panel_ili9488_set_gap(
+    esp_lcd_panel_t *panel, int x_gap, int y_gap)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_SET_GAP,
+            .x_start = x_gap, .y_start = y_gap
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    ili9488->x_gap = x_gap;
+    ili9488->y_gap = y_gap;
+    return ESP_OK;
+}
+
+static esp_err_t panel_ili9488_disp_on_off(esp_lcd_panel_t *panel, bool on_off)
+{
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_DISP_ON_OFF,
+            .x_start = on_off
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+    // In ESP-IDF v4.x the API used false for "on" and true for "off"
+    // invert the logic to be consistent with IDF v5.x.
+    on_off = !on_off;
+#endif
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_DISP_ON_OFF, ILI9488_TRACE_BEGIN,
+                  on_off);
+
+    if (ili9488->startup_stage != ILI9488_STARTUP_DONE)
+    {
+        // The startup sequence has not completed yet, record if the display
+        // should be turned on once it does. Turning it on completes the
+        // sequence right away, which sends DISPON.
+        ili9488->startup_display_on = on_off;
+        if (!on_off)
+        {
+            ILI9488_TRACE(ili9488, ILI9488_TRACE_DISP_ON_OFF,
+                          ILI9488_TRACE_END, on_off);
+            return ESP_OK;
+        }
+        panel_ili9488_complete_startup(ili9488);
+    }
+    else if (on_off)
+    {
+        panel_ili9488_tx_param(ili9488, LCD_CMD_DISPON, NULL, 0);
+    }
+    else
+    {
+        panel_ili9488_tx_param(ili9488, LCD_CMD_DISPOFF, NULL, 0);
+    }
+
+    // give time for the ILI9488 to recover after an on/off command, draws can
+    // continue while it does and only other commands will wait.
+    ili9488->command_deadline_us =
+        esp_timer_get_time() + ILI9488_DISP_ON_OFF_DELAY_US;
+
+    ILI9488_TRACE(ili9488, ILI9488_TRACE_DISP_ON_OFF, ILI9488_TRACE_END,
+                  on_off);
+    return ESP_OK;
+}
+
+static esp_err_t esp_lcd_new_panel_ili9488_internal(
+    const esp_lcd_panel_io_handle_t io,
+    const esp_lcd_panel_dev_config_t *panel_dev_config,
+    const size_t buffer_size,
+    bool ips,
+    esp_lcd_panel_handle_t *ret_panel)
+{
+    esp_err_t ret = ESP_OK;
+    ili9488_panel_t *ili9488 = NULL;
+    ESP_GOTO_ON_FALSE(io && panel_dev_config && ret_panel, ESP_ERR_INVALID_ARG,
+                      err, TAG, "invalid argument");
+    ili9488 = (ili9488_panel_t *)(calloc(1, sizeof(ili9488_panel_t)));
+    ESP_GOTO_ON_FALSE(ili9488, ESP_ERR_NO_MEM, err, TAG, "no mem for ili9488 panel");
+#if CONFIG_ILI9488_ENABLE_TRACE
+    ili9488->trace_id = atomic_fetch_add(&ili9488_trace_panels, 1);
+#endif
+
+    if (panel_dev_config->reset_gpio_num >= 0)
+    {
+        gpio_config_t cfg;
+        memset(&cfg, 0, sizeof(gpio_config_t));
+        esp_rom_gpio_pad_select_gpio(panel_dev_config->reset_gpio_num);
+        cfg.pin_bit_mask = BIT64(panel_dev_config->reset_gpio_num);
+        cfg.mode = GPIO_MODE_OUTPUT;
+        ESP_GOTO_ON_ERROR(gpio_config(&cfg), err, TAG,
+                          "configure GPIO for RESET line failed");
+    }
+
+    ili9488->ips = ips;
+    ili9488->te_gpio_num = GPIO_NUM_NC;
+    ili9488->frame_width = ILI9488_FRAME_WIDTH;
+    ili9488->frame_height = ILI9488_FRAME_HEIGHT;
+    portMUX_INITIALIZE(&ili9488->draw_lock);
+    panel_ili9488_invalidate_window(ili9488);
+
+    const ili9488_vendor_config_t *vendor_config =
+        (const ili9488_vendor_config_t *)panel_dev_config->vendor_config;
+    if (vendor_config && vendor_config->flags.enable_te_sync)
+    {
+        ESP_GOTO_ON_FALSE(vendor_config->te_gpio_num >= 0, ESP_ERR_INVALID_ARG,
+                          err, TAG, "TE GPIO must be specified");
+        ili9488->te_semaphore = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(ili9488->te_semaphore, ESP_ERR_NO_MEM, err, TAG,
+                          "no mem for TE semaphore");
+
+        gpio_config_t cfg;
+        memset(&cfg, 0, sizeof(gpio_config_t));
+        cfg.pin_bit_mask = BIT64(vendor_config->te_gpio_num);
+        cfg.mode = GPIO_MODE_INPUT;
+        cfg.intr_type = GPIO_INTR_POSEDGE;
+        ESP_GOTO_ON_ERROR(gpio_config(&cfg), err, TAG,
+                          "configure GPIO for TE line failed");
+        ili9488->te_gpio_num = vendor_config->te_gpio_num;
+
+        // The GPIO ISR service may have already been installed by the
+        // application, this is not considered an error.
+        esp_err_t isr_err = gpio_install_isr_service(0);
+        ESP_GOTO_ON_FALSE(isr_err == ESP_OK || isr_err == ESP_ERR_INVALID_STATE,
+                          isr_err, err, TAG, "install GPIO ISR service failed");
+        ESP_GOTO_ON_ERROR(gpio_isr_handler_add(vendor_config->te_gpio_num,
+                                               panel_ili9488_te_isr, ili9488),
+                          err, TAG, "add TE GPIO ISR handler failed");
+        ili9488->te_isr_added = true;
+        ili9488->te_sync_min_pixels = vendor_config->te_sync_min_pixels ?
+            vendor_config->te_sync_min_pixels :
+            ILI9488_TEAR_EFFECT_DEFAULT_MIN_PIXELS;
+        ESP_LOGI(TAG, "Using GPIO:%d for TE synchronization",
+                 ili9488->te_gpio_num);
+    }
+    else if (vendor_config && vendor_config->flags.enable_scanline_sync)
+    {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        ESP_GOTO_ON_FALSE(vendor_config->scanline_sync_pclk_hz > 0,
+                          ESP_ERR_INVALID_ARG, err, TAG,
+                          "Scanline synchronization requires the bus clock");
+        ili9488->scanline_sync = true;
+        ili9488->scanline_sync_pclk_hz = vendor_config->scanline_sync_pclk_hz;
+        ili9488->scanline_sync_min_pixels = vendor_config->scanline_sync_min_pixels;
+        ESP_LOGI(TAG, "Using scanline synchronization");
+#else
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, err, TAG,
+                          "Scanline synchronization requires ESP-IDF v5.0 or later");
+#endif
+    }
+
+    if (panel_dev_config->bits_per_pixel == 16)
+    {
+        ili9488->color_mode = ILI9488_COLOR_MODE_16BIT;
+    }
+    else
+    {
+        if (panel_dev_config->bits_per_pixel == 3)
+        {
+            // Two pixels are sent per byte, every slice except the last one
+            // must contain an even number of pixels.
+            ESP_GOTO_ON_FALSE(buffer_size >= 2, ESP_ERR_INVALID_ARG, err, TAG,
+                              "3-bit color mode requires a buffer_size of at "
+                              "least two pixels");
+            ili9488->color_mode = ILI9488_COLOR_MODE_3BIT;
+            ili9488->buffer_size = buffer_size & ~0x1;
+        }
+        else
+        {
+            if (buffer_size == 0)
+            {
+                ESP_LOGW(TAG, "No color conversion buffer size specified, only "
+                              "esp_lcd_ili9488_draw_bitmap_rgb666 can be used");
+            }
+            ili9488->color_mode = ILI9488_COLOR_MODE_18BIT;
+            ili9488->buffer_size = buffer_size;
+        }
+
+        // Keep the number of pixels per slice a multiple of four so that all
+        // slices of a draw have the same alignment as the first one.
+        if (ili9488->buffer_size >= 4)
+        {
+            ili9488->buffer_size &= ~0x3;
+        }
+
+        if (ili9488->color_mode == ILI9488_COLOR_MODE_3BIT)
+        {
+            ESP_LOGI(TAG, "Converting from RGB565 to 3-bit color data");
+            ili9488->convert_color =
+                vendor_config && vendor_config->flags.swap_color_bytes ?
+                    esp_lcd_ili9488_rgb565_swapped_to_rgb111 :
+                    esp_lcd_ili9488_rgb565_to_rgb111;
+            ili9488->color_data_bytes_per_pixel = 2;
+        }
+        else if (panel_dev_config->bits_per_pixel == 24)
+        {
+            ESP_LOGI(TAG, "Converting from RGB888 color data");
+            ili9488->convert_color = esp_lcd_ili9488_rgb888_to_rgb666;
+            ili9488->color_data_bytes_per_pixel = 3;
+        }
+        else if (panel_dev_config->bits_per_pixel == 32)
+        {
+            ESP_LOGI(TAG, "Converting from XRGB8888 color data");
+            ili9488->convert_color = esp_lcd_ili9488_xrgb8888_to_rgb666;
+            ili9488->color_data_bytes_per_pixel = 4;
+        }
+        else if (vendor_config && vendor_config->flags.swap_color_bytes)
+        {
+            ESP_LOGI(TAG, "Color data will be byte swapped during conversion");
+            ili9488->convert_color = esp_lcd_ili9488_rgb565_swapped_to_rgb666;
+            ili9488->color_data_bytes_per_pixel = 2;
+        }
+        else
+        {
+            ili9488->convert_color = esp_lcd_ili9488_rgb565_to_rgb666;
+            ili9488->color_data_bytes_per_pixel = 2;
+        }
+        size_t buffer_count = 1;
+        if (vendor_config && vendor_config->color_buffer_count > 1)
+        {
+            buffer_count = vendor_config->color_buffer_count;
+        }
+        ESP_GOTO_ON_FALSE(buffer_count <= ILI9488_MAX_COLOR_BUFFERS,
+                          ESP_ERR_INVALID_ARG, err, TAG,
+                          "At most %d color conversion buffers are supported",
+                          ILI9488_MAX_COLOR_BUFFERS);
+
+        // Allocate DMA buffer(s) for color conversions
+        for (size_t idx = 0; buffer_size > 0 && idx < buffer_count; idx++)
+        {
+            ili9488->color_buffers[idx] =
+                (uint8_t *)heap_caps_malloc(
+                    panel_ili9488_bus_bytes(ili9488, buffer_size), MALLOC_CAP_DMA);
+            ESP_GOTO_ON_FALSE(ili9488->color_buffers[idx], ESP_ERR_NO_MEM, err,
+                              TAG, "Failed to allocate DMA color conversion buffer");
+            ili9488->color_buffer_count++;
+        }
+    }
+
+    if (vendor_config && vendor_config->flags.enable_shadow_framebuffer)
+    {
+        ESP_GOTO_ON_FALSE(ili9488->color_mode == ILI9488_COLOR_MODE_18BIT &&
+                          ili9488->color_buffer_count > 0,
+                          ESP_ERR_INVALID_ARG, err, TAG,
+                          "The shadow framebuffer requires 18-bit color mode "
+                          "and a color conversion buffer");
+        ili9488->shadow = (uint8_t *)heap_caps_malloc(
+            ILI9488_FRAME_WIDTH * ILI9488_FRAME_HEIGHT * 3,
+            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        ESP_GOTO_ON_FALSE(ili9488->shadow, ESP_ERR_NO_MEM, err, TAG,
+                          "Failed to allocate PSRAM shadow framebuffer");
+        ili9488->shadow_row = (uint8_t *)malloc(ILI9488_FRAME_HEIGHT * 3);
+        ESP_GOTO_ON_FALSE(ili9488->shadow_row, ESP_ERR_NO_MEM, err, TAG,
+                          "no mem for shadow framebuffer row");
+        panel_ili9488_invalidate_tiles(ili9488);
+        ESP_LOGI(TAG, "Using PSRAM shadow framebuffer");
+    }
+    else if (vendor_config && vendor_config->flags.enable_tile_hashes)
+    {
+        ESP_GOTO_ON_FALSE(ili9488->color_mode != ILI9488_COLOR_MODE_3BIT,
+                          ESP_ERR_INVALID_ARG, err, TAG,
+                          "Tile hashes are not supported in 3-bit color mode");
+        ili9488->tile_hashes =
+            (ili9488_tile_hash_t *)calloc(ILI9488_TILE_COUNT,
+                                          sizeof(ili9488_tile_hash_t));
+        ESP_GOTO_ON_FALSE(ili9488->tile_hashes, ESP_ERR_NO_MEM, err, TAG,
+                          "no mem for tile hashes");
+        ESP_LOGI(TAG, "Using tile hashes to detect unchanged areas");
+    }
+
+    ili9488->memory_access_control = LCD_CMD_MX_BIT | LCD_CMD_BGR_BIT;
+
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(6, 0, 0)
+    switch (panel_dev_config->color_space)
+    {
+        case ESP_LCD_COLOR_SPACE_RGB:
+            ESP_LOGI(TAG, "Configuring for RGB color order");
+            ili9488->memory_access_control &= ~LCD_CMD_BGR_BIT;
+            break;
+        case ESP_LCD_COLOR_SPACE_BGR:
+            ESP_LOGI(TAG, "Configuring for BGR color order");
+            break;
+        default:
+            ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG,
+                              "Unsupported color mode!");
+    }
+#else
+    switch (panel_dev_config->rgb_ele_order)
+    {
+    case LCD_RGB_ELEMENT_ORDER_RGB:
+            ESP_LOGI(TAG, "Configuring for RGB color order");
+            ili9488->memory_access_control &= ~LCD_CMD_BGR_BIT;
+            break;
+    case LCD_RGB_ELEMENT_ORDER_BGR:
             ESP_LOGI(TAG, "Configuring for BGR color order");
             break;
         default:
             ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG,
                               "Unsupported color mode!");
     }
+#endif
+
+    ili9488->io = io;
+    ili9488->reset_gpio_num = panel_dev_config->reset_gpio_num;
+    ili9488->reset_level = panel_dev_config->flags.reset_active_high;
+    ili9488->base.del = panel_ili9488_del;
+    ili9488->base.reset = panel_ili9488_reset;
+    ili9488->base.init = panel_ili9488_init;
+    ili9488->base.draw_bitmap = panel_ili9488_draw_bitmap;
+    ili9488->base.invert_color = panel_ili9488_invert_color;
+    ili9488->base.set_gap = panel_ili9488_set_gap;
+    ili9488->base.mirror = panel_ili9488_mirror;
+    ili9488->base.swap_xy = panel_ili9488_swap_xy;
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+    ili9488->base.disp_off = panel_ili9488_disp_on_off;
+#else
+    ili9488->base.disp_on_off = panel_ili9488_disp_on_off;
+#endif
+    *ret_panel = &(ili9488->base);
+    ESP_LOGI(TAG, "new ili9488 panel @%p", ili9488);
+
+    return ESP_OK;
+
+err:
+    if (ili9488)
+    {
+        if (panel_dev_config->reset_gpio_num >= 0)
+        {
+            gpio_reset_pin(panel_dev_config->reset_gpio_num);
+        }
+        if (ili9488->te_isr_added)
+        {
+            gpio_isr_handler_remove(ili9488->te_gpio_num);
+        }
+        if (ili9488->te_gpio_num >= 0)
+        {
+            gpio_reset_pin(ili9488->te_gpio_num);
+        }
+        if (ili9488->te_semaphore != NULL)
+        {
+            vSemaphoreDelete(ili9488->te_semaphore);
+        }
+        for (size_t idx = 0; idx < ili9488->color_buffer_count; idx++)
+        {
+            heap_caps_free(ili9488->color_buffers[idx]);
+        }
+        if (ili9488->shadow != NULL)
+        {
+            heap_caps_free(ili9488->shadow);
+        }
+        free(ili9488->shadow_row);
+        free(ili9488->tile_hashes);
+        free(ili9488);
+    }
+    return ret;
+}
+
+esp_err_t esp_lcd_new_panel_ili9488(
+    const esp_lcd_panel_io_handle_t io,
+    const esp_lcd_panel_dev_config_t *panel_dev_config,
+    const size_t buffer_size,
+    esp_lcd_panel_handle_t *ret_panel)
+{
+    return esp_lcd_new_panel_ili9488_internal(io, panel_dev_config, buffer_size, false, ret_panel);
+}
+
+esp_err_t esp_lcd_new_panel_ili9488_ips(
+    const esp_lcd_panel_io_handle_t io,
+    const esp_lcd_panel_dev_config_t *panel_dev_config,
+    const size_t buffer_size,
+    esp_lcd_panel_handle_t *ret_panel)
+{
+    return esp_lcd_new_panel_ili9488_internal(io, panel_dev_config, buffer_size, true, ret_panel);
+}
+
+esp_err_t esp_lcd_ili9488_draw_bitmap_rgb666(
+    esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end,
+    int y_end, const void *color_data)
+{
+    ESP_RETURN_ON_FALSE(panel && color_data, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    ESP_RETURN_ON_FALSE(ili9488->color_mode == ILI9488_COLOR_MODE_18BIT,
+                        ESP_ERR_INVALID_STATE, TAG,
+                        "RGB666 color data requires 18-bit color mode");
+    assert((x_start < x_end) && (y_start < y_end) &&
+            "starting position must be smaller than end position");
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_RGB666,
+            .x_start = x_start, .y_start = y_start,
+            .x_end = x_end, .y_end = y_end,
+            .color_data = color_data
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = panel_ili9488_begin_draw(ili9488);
+
+    x_start += ili9488->x_gap;
+    x_end += ili9488->x_gap;
+    y_start += ili9488->y_gap;
+    y_end += ili9488->y_gap;
+
+    size_t color_data_len = (x_end - x_start) * (y_end - y_start);
+
+    // The color data is already in the format used by the display and is
+    // transmitted directly without using the color conversion buffers.
+    panel_ili9488_update_tiles(ili9488, x_start, y_start, x_end, y_end,
+                               color_data, (x_end - x_start) * 3);
+    ESP_GOTO_ON_ERROR(
+        panel_ili9488_prepare_write(ili9488, x_start, y_start, x_end, y_end),
+        err, TAG, "set address window failed");
+    ESP_GOTO_ON_ERROR(
+        panel_ili9488_tx_color(ili9488, LCD_CMD_RAMWR, color_data,
+                               color_data_len * 3),
+        err, TAG, "send color data failed");
+    panel_ili9488_count_draws(ili9488, 1, start_us);
+    panel_ili9488_draw_queued(ili9488, ili9488->draw_done_cb,
+                              ili9488->draw_done_user_ctx);
+    return ESP_OK;
+
+err:
+    panel_ili9488_invalidate_area(ili9488, x_start, y_start, x_end, y_end);
+    panel_ili9488_abort_draw(ili9488);
+    return ret;
+}
+
+static bool panel_ili9488_rects_overlap(
+    const esp_lcd_ili9488_rect_t *a, const esp_lcd_ili9488_rect_t *b)
+{
+    return a->x_start < b->x_end && b->x_start < a->x_end &&
+           a->y_start < b->y_end && b->y_start < a->y_end;
+}
+
+// Orders the rectangles by column range and then by starting row so that
+// rectangles sharing the same columns are drawn one after another. This is
+// only done when none of the rectangles overlap, otherwise the order in which
+// they are drawn affects the result.
+static void panel_ili9488_sort_rects(
+    const esp_lcd_ili9488_rect_t **rects, size_t count)
+{
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        for (size_t other = idx + 1; other < count; other++)
+        {
+            if (panel_ili9488_rects_overlap(rects[idx], rects[other]))
+            {
+                return;
+            }
+        }
+    }
+
+    for (size_t idx = 1; idx < count; idx++)
+    {
+        const esp_lcd_ili9488_rect_t *rect = rects[idx];
+        size_t pos = idx;
+        while (pos > 0 &&
+               (rects[pos - 1]->x_start > rect->x_start ||
+                (rects[pos - 1]->x_start == rect->x_start &&
+                 (rects[pos - 1]->x_end > rect->x_end ||
+                  (rects[pos - 1]->x_end == rect->x_end &&
+                   rects[pos - 1]->y_start > rect->y_start)))))
+        {
+            rects[pos] = rects[pos - 1];
+            pos--;
+        }
+        rects[pos] = rect;
+    }
+}
+
+esp_err_t esp_lcd_ili9488_draw_bitmaps(
+    esp_lcd_panel_handle_t panel, const esp_lcd_ili9488_rect_t *rects,
+    size_t count)
+{
+    ESP_RETURN_ON_FALSE(panel && (rects || count == 0), ESP_ERR_INVALID_ARG,
+                        TAG, "invalid argument");
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        ESP_RETURN_ON_FALSE(rects[idx].x_start < rects[idx].x_end &&
+                            rects[idx].y_start < rects[idx].y_end &&
+                            rects[idx].color_data, ESP_ERR_INVALID_ARG, TAG,
+                            "invalid rectangle %d", (int)idx);
+    }
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_BITMAPS,
+            .color_data = rects, .count = count
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = panel_ili9488_begin_draw(ili9488);
+
+    // With the shadow framebuffer or tile hashes only the changed tiles of
+    // each area are sent, the areas are drawn individually in the order
+    // provided.
+    bool track_tiles = ili9488->shadow != NULL || ili9488->tile_hashes != NULL;
+    for (size_t idx = 0; track_tiles && idx < count; idx++)
+    {
+        ESP_GOTO_ON_ERROR(
+            panel_ili9488_draw(ili9488, rects[idx].x_start, rects[idx].y_start,
+                               rects[idx].x_end, rects[idx].y_end,
+                               rects[idx].color_data),
+            err, TAG, "draw failed");
+    }
+
+    const esp_lcd_ili9488_rect_t *batch[ILI9488_MAX_BATCH_RECTS];
+    for (size_t offset = 0; !track_tiles && offset < count;
+         offset += ILI9488_MAX_BATCH_RECTS)
+    {
+        size_t batch_count = MIN(count - offset, ILI9488_MAX_BATCH_RECTS);
+        for (size_t idx = 0; idx < batch_count; idx++)
+        {
+            batch[idx] = &rects[offset + idx];
+        }
+        panel_ili9488_sort_rects(batch, batch_count);
+
+        size_t idx = 0;
+        while (idx < batch_count)
+        {
+            // Find the following rectangles which use the same columns and
+            // start on or above the row after the last one. These are sent
+            // as a single memory write, any rows of a rectangle that will be
+            // overwritten by the next one are skipped. In 3-bit color mode
+            // only an even number of pixels can be continued.
+            size_t group_end = idx + 1;
+            while (group_end < batch_count &&
+                   batch[group_end]->x_start == batch[idx]->x_start &&
+                   batch[group_end]->x_end == batch[idx]->x_end &&
+                   batch[group_end]->y_start >= batch[group_end - 1]->y_start &&
+                   batch[group_end]->y_start <= batch[group_end - 1]->y_end &&
+                   batch[group_end]->y_end >= batch[group_end - 1]->y_end &&
+                   (ili9488->color_mode != ILI9488_COLOR_MODE_3BIT ||
+                    ((batch[group_end]->y_start - batch[group_end - 1]->y_start) *
+                     (batch[idx]->x_end - batch[idx]->x_start)) % 2 == 0))
+            {
+                group_end++;
+            }
+
+            int x_start = batch[idx]->x_start + ili9488->x_gap;
+            int x_end = batch[idx]->x_end + ili9488->x_gap;
+            int y_start = batch[idx]->y_start + ili9488->y_gap;
+            int y_end = batch[group_end - 1]->y_end + ili9488->y_gap;
+            size_t width = x_end - x_start;
+            int write_mode = ILI9488_WRITE_START;
+            for (; idx < group_end; idx++)
+            {
+                int rows = batch[idx]->y_end - batch[idx]->y_start;
+                if (idx + 1 < group_end)
+                {
+                    rows = batch[idx + 1]->y_start - batch[idx]->y_start;
+                }
+                if (rows == 0)
+                {
+                    continue;
+                }
+                ili9488_color_source_t source = panel_ili9488_color_source(
+                    ili9488, batch[idx]->color_data, width * rows);
+                ESP_GOTO_ON_ERROR(
+                    panel_ili9488_write_pixels(ili9488, x_start, y_start,
+                                               x_end, y_end, &source,
+                                               width * rows, write_mode),
+                    err, TAG, "draw failed");
+                write_mode = ILI9488_WRITE_CONTINUE;
+            }
+        }
+    }
+
+    panel_ili9488_count_draws(ili9488, count, start_us);
+    panel_ili9488_draw_queued(ili9488, ili9488->draw_done_cb,
+                              ili9488->draw_done_user_ctx);
+    return ESP_OK;
+
+err:
+    panel_ili9488_abort_draw(ili9488);
+    return ret;
+}
+
+esp_err_t esp_lcd_ili9488_fill_rect(
+    esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end,
+    int y_end, uint32_t color)
+{
+    ESP_RETURN_ON_FALSE(panel && x_start < x_end && y_start < y_end,
+                        ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_FILL,
+            .x_start = x_start, .y_start = y_start,
+            .x_end = x_end, .y_end = y_end,
+            .color = color
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = panel_ili9488_begin_draw(ili9488);
+    size_t pattern_size =
+        panel_ili9488_bus_bytes(ili9488, ILI9488_FILL_PATTERN_PIXELS);
+
+    x_start += ili9488->x_gap;
+    x_end += ili9488->x_gap;
+    y_start += ili9488->y_gap;
+    y_end += ili9488->y_gap;
+
+    bool refill = ili9488->fill_color != color;
+    if (ili9488->fill_pattern == NULL)
+    {
+        ili9488->fill_pattern =
+            (uint8_t *)heap_caps_malloc(pattern_size, MALLOC_CAP_DMA);
+        ESP_GOTO_ON_FALSE(ili9488->fill_pattern, ESP_ERR_NO_MEM, err, TAG,
+                          "Failed to allocate DMA fill pattern buffer");
+        refill = true;
+    }
+    else if (refill)
+    {
+        // The pattern may still be in use by the previous fill, the NOP
+        // ensures it has been sent before the pattern is updated.
+        panel_ili9488_tx_param(ili9488, LCD_CMD_NOP, NULL, 0);
+    }
+
+    if (refill)
+    {
+        // Store a single pixel in the display format and replicate it to
+        // fill the pattern buffer. In 3-bit color mode both pixels of the
+        // first byte are set.
+        size_t filled = 3;
+        if (ili9488->color_mode == ILI9488_COLOR_MODE_16BIT)
+        {
+            uint16_t pixel = color;
+            memcpy(ili9488->fill_pattern, &pixel, sizeof(pixel));
+            filled = sizeof(pixel);
+        }
+        else
+        {
+            ili9488->convert_color(ili9488->fill_pattern, &color, 1);
+        }
+        if (ili9488->color_mode == ILI9488_COLOR_MODE_3BIT)
+        {
+            ili9488->fill_pattern[0] |= ili9488->fill_pattern[0] >> 3;
+            filled = 1;
+        }
+        for (; filled < pattern_size; filled *= 2)
+        {
+            memcpy(ili9488->fill_pattern + filled, ili9488->fill_pattern,
+                   MIN(filled, pattern_size - filled));
+        }
+        ili9488->fill_color = color;
+    }
+
+    if (ili9488->shadow != NULL)
+    {
+        // Build a row of the fill color in the shadow framebuffer, masked the
+        // same way as converted color data.
+        uint8_t *row = ili9488->shadow_row;
+        for (size_t idx = 0; idx < 3; idx++)
+        {
+            row[idx] = ili9488->fill_pattern[idx] & ILI9488_RGB666_MASK;
+        }
+        for (size_t filled = 3; filled < ILI9488_FRAME_HEIGHT * 3; filled *= 2)
+        {
+            memcpy(row + filled, row, MIN(filled, ILI9488_FRAME_HEIGHT * 3 - filled));
+        }
+    }
+    panel_ili9488_update_tiles(ili9488, x_start, y_start, x_end, y_end,
+                               ili9488->shadow_row, 0);
+
+    // The same pattern is sent repeatedly, the first transfer starts the
+    // memory write and all following transfers continue it.
+    ESP_GOTO_ON_ERROR(
+        panel_ili9488_prepare_write(ili9488, x_start, y_start, x_end, y_end),
+        err, TAG, "set address window failed");
+    size_t pixels = (x_end - x_start) * (y_end - y_start);
+    int lcd_cmd = LCD_CMD_RAMWR;
+    while (pixels > 0)
+    {
+        size_t count = MIN(pixels, ILI9488_FILL_PATTERN_PIXELS);
+        ESP_GOTO_ON_ERROR(
+            panel_ili9488_tx_color(ili9488, lcd_cmd, ili9488->fill_pattern,
+                                   panel_ili9488_bus_bytes(ili9488, count)),
+            err, TAG, "send fill pattern failed");
+        lcd_cmd = LCD_CMD_WRMEMC;
+        pixels -= count;
+    }
+    panel_ili9488_count_draws(ili9488, 1, start_us);
+    panel_ili9488_draw_queued(ili9488, ili9488->draw_done_cb,
+                              ili9488->draw_done_user_ctx);
+    return ESP_OK;
+
+err:
+    panel_ili9488_invalidate_area(ili9488, x_start, y_start, x_end, y_end);
+    panel_ili9488_abort_draw(ili9488);
+    return ret;
+}
+
+esp_err_t esp_lcd_ili9488_set_scroll_area(
+    esp_lcd_panel_handle_t panel, uint16_t top_fixed_lines,
+    uint16_t scroll_lines, uint16_t bottom_fixed_lines)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(
+        top_fixed_lines + scroll_lines + bottom_fixed_lines == ILI9488_VISIBLE_SCANLINES,
+        ESP_ERR_INVALID_ARG, TAG, "scroll areas must cover %d lines",
+        ILI9488_VISIBLE_SCANLINES);
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_SCROLL_AREA,
+            .x_start = top_fixed_lines, .y_start = scroll_lines,
+            .x_end = bottom_fixed_lines
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+    ili9488->scroll_top_fixed_lines = top_fixed_lines;
+    ili9488->scroll_lines = scroll_lines;
+    return panel_ili9488_tx_param(ili9488, LCD_CMD_VSCRDEF, (uint8_t[]) {
+        (top_fixed_lines >> 8) & 0xFF,
+        top_fixed_lines & 0xFF,
+        (scroll_lines >> 8) & 0xFF,
+        scroll_lines & 0xFF,
+        (bottom_fixed_lines >> 8) & 0xFF,
+        bottom_fixed_lines & 0xFF,
+    }, 6);
+}
+
+esp_err_t esp_lcd_ili9488_scroll(esp_lcd_panel_handle_t panel,
+                                 uint16_t start_line)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_SCROLL,
+            .x_start = start_line
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+    ESP_RETURN_ON_FALSE(ili9488->scroll_lines > 0, ESP_ERR_INVALID_STATE, TAG,
+                        "scroll area has not been defined");
+    ESP_RETURN_ON_FALSE(
+        start_line >= ili9488->scroll_top_fixed_lines &&
+        start_line < ili9488->scroll_top_fixed_lines + ili9488->scroll_lines,
+        ESP_ERR_INVALID_ARG, TAG, "start line must be within the scroll area");
+
+    return panel_ili9488_tx_param(ili9488, LCD_CMD_VSCSAD, (uint8_t[]) {
+        (start_line >> 8) & 0xFF,
+        start_line & 0xFF,
+    }, 2);
+}
+
+esp_err_t esp_lcd_ili9488_set_partial_area(
+    esp_lcd_panel_handle_t panel, uint16_t start_line, uint16_t end_line)
+{
+    ESP_RETURN_ON_FALSE(panel && start_line < end_line &&
+                        end_line <= ILI9488_VISIBLE_SCANLINES,
+                        ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_PARTIAL_AREA,
+            .x_start = start_line, .y_start = end_line
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+    ili9488->partial_start_line = start_line;
+    ili9488->partial_end_line = end_line;
+    return panel_ili9488_tx_param(ili9488, LCD_CMD_PTLAR, (uint8_t[]) {
+        (start_line >> 8) & 0xFF,
+        start_line & 0xFF,
+        ((end_line - 1) >> 8) & 0xFF,
+        (end_line - 1) & 0xFF,
+    }, 4);
+}
+
+esp_err_t esp_lcd_ili9488_partial_mode(esp_lcd_panel_handle_t panel,
+                                       bool enable)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_PARTIAL_MODE,
+            .x_start = enable
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+    if (enable == ili9488->partial_mode)
+    {
+        return ESP_OK;
+    }
+
+    if (enable)
+    {
+        ESP_RETURN_ON_FALSE(ili9488->partial_end_line > 0,
+                            ESP_ERR_INVALID_STATE, TAG,
+                            "partial area has not been defined");
+        ESP_RETURN_ON_ERROR(
+            panel_ili9488_tx_param(ili9488, LCD_CMD_PTLON, NULL, 0), TAG,
+            "send PTLON failed");
+    }
+    else
+    {
+        ESP_RETURN_ON_ERROR(
+            panel_ili9488_tx_param(ili9488, LCD_CMD_NORON, NULL, 0), TAG,
+            "send NORON failed");
+    }
+    ili9488->partial_mode = enable;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_ili9488_register_draw_done_callback(
+    esp_lcd_panel_handle_t panel, esp_lcd_ili9488_draw_done_cb_t callback,
+    void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_DRAW_DONE_CB,
+            .callback = callback, .user_ctx = user_ctx
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
+    }
+
+    if (!ili9488->draw_callbacks)
+    {
+        ili9488->idle_semaphore = xSemaphoreCreateBinary();
+        ESP_RETURN_ON_FALSE(ili9488->idle_semaphore, ESP_ERR_NO_MEM, TAG,
+                            "no mem for idle semaphore");
+
+        // Ensure no transfers are in flight before the completion callback is
+        // replaced.
+        panel_ili9488_tx_param(ili9488, LCD_CMD_NOP, NULL, 0);
+        ili9488->transfers_queued = 0;
+        ili9488->transfers_done = 0;
+        const esp_lcd_panel_io_callbacks_t callbacks =
+        {
+            .on_color_trans_done = panel_ili9488_color_trans_done,
+        };
+        ESP_LOGW(TAG, "replacing the on_color_trans_done callback of the "
+                      "panel IO, use the draw done callback instead");
+        esp_err_t err =
+            esp_lcd_panel_io_register_event_callbacks(ili9488->io, &callbacks,
+                                                      ili9488);
+        if (err != ESP_OK)
+        {
+            vSemaphoreDelete(ili9488->idle_semaphore);
+            ili9488->idle_semaphore = NULL;
+            ESP_LOGE(TAG, "register panel IO callbacks failed");
+            return err;
+        }
+        ili9488->draw_callbacks = true;
+    }
+
+    ili9488->draw_done_cb = callback;
+    ili9488->draw_done_user_ctx = user_ctx;
+    return ESP_OK;
 #else
-    switch (panel_dev_config->rgb_ele_order)
+    ESP_LOGE(TAG, "Draw done callbacks require ESP-IDF v5.0 or later");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t esp_lcd_ili9488_draw_bitmap_with_cb(
+    esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end,
+    int y_end, const void *color_data,
+    esp_lcd_ili9488_draw_done_cb_t callback, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(panel && color_data, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    ESP_RETURN_ON_FALSE(ili9488->draw_callbacks, ESP_ERR_INVALID_STATE, TAG,
+                        "draw done callbacks have not been enabled");
+    if (panel_ili9488_use_draw_task(ili9488))
     {
-    case LCD_RGB_ELEMENT_ORDER_RGB:
-            ESP_LOGI(TAG, "Configuring for RGB color order");
-            ili9488->memory_access_control &= ~LCD_CMD_BGR_BIT;
-            break;
-    case LCD_RGB_ELEMENT_ORDER_BGR:
-            ESP_LOGI(TAG, "Configuring for BGR color order");
-            break;
-        default:
-            ESP_GOTO_ON_FALSE(false, ESP_ERR_INVALID_ARG, err, TAG,
-                              "Unsupported color mode!");
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_BITMAP_WITH_CB,
+            .x_start = x_start, .y_start = y_start,
+            .x_end = x_end, .y_end = y_end,
+            .color_data = color_data,
+            .callback = callback, .user_ctx = user_ctx
+        };
+        return panel_ili9488_submit_and_wait(ili9488, &request);
     }
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = panel_ili9488_begin_draw(ili9488);
+
+    ESP_GOTO_ON_ERROR(
+        panel_ili9488_draw(ili9488, x_start, y_start, x_end, y_end, color_data),
+        err, TAG, "draw failed");
+    panel_ili9488_count_draws(ili9488, 1, start_us);
+    panel_ili9488_draw_queued(ili9488, callback, user_ctx);
+    return ESP_OK;
+
+err:
+    panel_ili9488_abort_draw(ili9488);
+    return ret;
+}
+
+esp_err_t esp_lcd_ili9488_wait_idle(esp_lcd_panel_handle_t panel,
+                                    uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+
+    if (panel_ili9488_use_draw_task(ili9488))
+    {
+        // Wait until the draws submitted before this call have been queued,
+        // without draw done callbacks this also waits for their transfers.
+        ili9488_draw_request_t request =
+        {
+            .type = ILI9488_DRAW_REQUEST_WAIT_IDLE
+        };
+        esp_err_t ret = panel_ili9488_submit_and_wait(ili9488, &request);
+        if (ret != ESP_OK || !ili9488->draw_callbacks)
+        {
+            return ret;
+        }
+    }
+
+    if (!ili9488->draw_callbacks)
+    {
+        // Without the completion callback the only way to wait for the
+        // queued transfers is to send a command, the panel IO waits for all
+        // queued transfers before sending it.
+        return panel_ili9488_tx_param(ili9488, LCD_CMD_NOP, NULL, 0);
+    }
+
+    // Discard any stale idle notification, the transfer counters are checked
+    // after each wake up.
+    xSemaphoreTake(ili9488->idle_semaphore, 0);
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    while (ili9488->transfers_done != ili9488->transfers_queued)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout ||
+            xSemaphoreTake(ili9488->idle_semaphore, timeout - elapsed) != pdTRUE)
+        {
+            if (ili9488->transfers_done == ili9488->transfers_queued)
+            {
+                break;
+            }
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_ili9488_get_stats(
+    esp_lcd_panel_handle_t panel, esp_lcd_ili9488_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(panel && stats, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid argument");
+#if CONFIG_ILI9488_ENABLE_STATS
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    memcpy(stats, &ili9488->stats, sizeof(esp_lcd_ili9488_stats_t));
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
 #endif
+}
 
-    ili9488->io = io;
-    ili9488->reset_gpio_num = panel_dev_config->reset_gpio_num;
-    ili9488->reset_level = panel_dev_config->flags.reset_active_high;
-    ili9488->base.del = panel_ili9488_del;
-    ili9488->base.reset = panel_ili9488_reset;
-    ili9488->base.init = panel_ili9488_init;
-    ili9488->base.draw_bitmap = panel_ili9488_draw_bitmap;
-    ili9488->base.invert_color = panel_ili9488_invert_color;
-    ili9488->base.set_gap = panel_ili9488_set_gap;
-    ili9488->base.mirror = panel_ili9488_mirror;
-    ili9488->base.swap_xy = panel_ili9488_swap_xy;
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
-    ili9488->base.disp_off = panel_ili9488_disp_on_off;
+esp_err_t esp_lcd_ili9488_reset_stats(esp_lcd_panel_handle_t panel)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+#if CONFIG_ILI9488_ENABLE_STATS
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    memset(&ili9488->stats, 0, sizeof(esp_lcd_ili9488_stats_t));
+    return ESP_OK;
 #else
-    ili9488->base.disp_on_off = panel_ili9488_disp_on_off;
+    return ESP_ERR_NOT_SUPPORTED;
 #endif
-    *ret_panel = &(ili9488->base);
-    ESP_LOGI(TAG, "new ili9488 panel @%p", ili9488);
+}
 
+esp_err_t esp_lcd_ili9488_get_startup_time(esp_lcd_panel_handle_t panel,
+                                           uint32_t *startup_time_us)
+{
+    ESP_RETURN_ON_FALSE(panel && startup_time_us, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    ESP_RETURN_ON_FALSE(ili9488->startup_time_us, ESP_ERR_INVALID_STATE, TAG,
+                        "first frame has not been shown yet");
+    *startup_time_us = ili9488->startup_time_us;
     return ESP_OK;
+}
 
-err:
-    if (ili9488)
+esp_err_t esp_lcd_ili9488_dump_trace(FILE *stream)
+{
+#if CONFIG_ILI9488_ENABLE_TRACE
+    ESP_RETURN_ON_FALSE(stream, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    unsigned head =
+        atomic_load_explicit(&ili9488_trace_head, memory_order_acquire);
+    unsigned tail = atomic_load(&ili9488_trace_tail);
+    if (head - tail > CONFIG_ILI9488_TRACE_BUFFER_SIZE)
     {
-        if (panel_dev_config->reset_gpio_num >= 0)
+        tail = head - CONFIG_ILI9488_TRACE_BUFFER_SIZE;
+    }
+    for (unsigned index = tail; index != head; index++)
+    {
+        ili9488_trace_entry_t *entry =
+            &ili9488_trace_entries[index % CONFIG_ILI9488_TRACE_BUFFER_SIZE];
+        unsigned sequence =
+            atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        uint32_t timestamp_us = entry->timestamp_us;
+        uint32_t value = entry->value;
+        uint8_t event = entry->event;
+        uint8_t phase = entry->phase;
+        uint8_t panel = entry->panel;
+        atomic_thread_fence(memory_order_acquire);
+        // Skip entries which are still being written or which have been
+        // overwritten by newer events while reading them.
+        if (sequence != index + 1 ||
+            atomic_load_explicit(&entry->sequence, memory_order_relaxed) !=
+                sequence)
         {
-            gpio_reset_pin(panel_dev_config->reset_gpio_num);
+            continue;
+        }
+        fprintf(stream, "ili9488-trace %" PRIu32 " %u %c %s %" PRIu32 "\n",
+                timestamp_us, panel, phase, ili9488_trace_event_names[event],
+                value);
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t esp_lcd_ili9488_clear_trace(void)
+{
+#if CONFIG_ILI9488_ENABLE_TRACE
+    atomic_store(&ili9488_trace_tail, atomic_load(&ili9488_trace_head));
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// Executes a request taken from the draw queue on the draw task.
+static esp_err_t panel_ili9488_execute_draw(
+    ili9488_panel_t *ili9488, const ili9488_draw_request_t *request)
+{
+    esp_lcd_panel_t *panel = &ili9488->base;
+    esp_err_t ret = ESP_OK;
+    switch (request->type)
+    {
+        case ILI9488_DRAW_REQUEST_BITMAP:
+            return panel->draw_bitmap(panel, request->x_start, request->y_start,
+                                      request->x_end, request->y_end,
+                                      request->color_data);
+        case ILI9488_DRAW_REQUEST_BITMAP_WITH_CB:
+            return esp_lcd_ili9488_draw_bitmap_with_cb(
+                panel, request->x_start, request->y_start, request->x_end,
+                request->y_end, request->color_data, request->callback,
+                request->user_ctx);
+        case ILI9488_DRAW_REQUEST_BITMAP_ASYNC:
+            if (ili9488->draw_callbacks)
+            {
+                ret = esp_lcd_ili9488_draw_bitmap_with_cb(
+                    panel, request->x_start, request->y_start, request->x_end,
+                    request->y_end, request->color_data, request->callback,
+                    request->user_ctx);
+                if (ret == ESP_OK)
+                {
+                    // The callback is invoked once the transfers complete.
+                    return ret;
+                }
+            }
+            else
+            {
+                ret = panel->draw_bitmap(panel, request->x_start,
+                                         request->y_start, request->x_end,
+                                         request->y_end, request->color_data);
+            }
+            // In 18-bit and 3-bit color mode the color data has been
+            // converted by now. In 16-bit color mode it is sent as-is and may
+            // still be read by the panel IO, the NOP waits for the queued
+            // transfers to complete.
+            if (ili9488->color_mode == ILI9488_COLOR_MODE_16BIT)
+            {
+                panel_ili9488_tx_param(ili9488, LCD_CMD_NOP, NULL, 0);
+            }
+            if (request->callback != NULL)
+            {
+                request->callback(panel, request->user_ctx);
+            }
+            return ret;
+        case ILI9488_DRAW_REQUEST_RGB666:
+            return esp_lcd_ili9488_draw_bitmap_rgb666(
+                panel, request->x_start, request->y_start, request->x_end,
+                request->y_end, request->color_data);
+        case ILI9488_DRAW_REQUEST_BITMAPS:
+            return esp_lcd_ili9488_draw_bitmaps(
+                panel, (const esp_lcd_ili9488_rect_t *)request->color_data,
+                request->count);
+        case ILI9488_DRAW_REQUEST_FILL:
+            return esp_lcd_ili9488_fill_rect(
+                panel, request->x_start, request->y_start, request->x_end,
+                request->y_end, request->color);
+        case ILI9488_DRAW_REQUEST_WAIT_IDLE:
+            // With draw done callbacks the submitting task waits for the
+            // transfers itself.
+            if (!ili9488->draw_callbacks)
+            {
+                ret = esp_lcd_ili9488_wait_idle(panel, 0);
+            }
+            return ret;
+        case ILI9488_DRAW_REQUEST_RESET:
+            return panel_ili9488_reset(panel);
+        case ILI9488_DRAW_REQUEST_INIT:
+            return panel_ili9488_init(panel);
+        case ILI9488_DRAW_REQUEST_INVERT_COLOR:
+            return panel_ili9488_invert_color(panel, request->x_start);
+        case ILI9488_DRAW_REQUEST_MIRROR:
+            return panel_ili9488_mirror(panel, request->x_start,
+                                        request->y_start);
+        case ILI9488_DRAW_REQUEST_SWAP_XY:
+            return panel_ili9488_swap_xy(panel, request->x_start);
+        case ILI9488_DRAW_REQUEST_SET_GAP:
+            return panel_ili9488_set_gap(panel, request->x_start,
+                                         request->y_start);
+        case ILI9488_DRAW_REQUEST_DISP_ON_OFF:
+            return panel_ili9488_disp_on_off(panel, request->x_start);
+        case ILI9488_DRAW_REQUEST_SCROLL_AREA:
+            return esp_lcd_ili9488_set_scroll_area(
+                panel, request->x_start, request->y_start, request->x_end);
+        case ILI9488_DRAW_REQUEST_SCROLL:
+            return esp_lcd_ili9488_scroll(panel, request->x_start);
+        case ILI9488_DRAW_REQUEST_PARTIAL_AREA:
+            return esp_lcd_ili9488_set_partial_area(panel, request->x_start,
+                                                    request->y_start);
+        case ILI9488_DRAW_REQUEST_PARTIAL_MODE:
+            return esp_lcd_ili9488_partial_mode(panel, request->x_start);
+        case ILI9488_DRAW_REQUEST_DRAW_DONE_CB:
+            return esp_lcd_ili9488_register_draw_done_callback(
+                panel, request->callback, request->user_ctx);
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void panel_ili9488_draw_task(void *arg)
+{
+    ili9488_panel_t *ili9488 = (ili9488_panel_t *)arg;
+    for (;;)
+    {
+        ili9488_draw_request_t request;
+        while (!panel_ili9488_dequeue_draw(ili9488, &request))
+        {
+            xSemaphoreTake(ili9488->draw_queue_items, portMAX_DELAY);
         }
-        if (ili9488->color_buffer != NULL)
+
+        if (request.type == ILI9488_DRAW_REQUEST_STOP)
         {
-            heap_caps_free(ili9488->color_buffer);
+            ili9488->draw_task = NULL;
+            xSemaphoreGive(request.done);
+            vTaskDelete(NULL);
+        }
+
+        esp_err_t ret = panel_ili9488_execute_draw(ili9488, &request);
+        if (request.done != NULL)
+        {
+            *request.result = ret;
+            xSemaphoreGive(request.done);
+        }
+        else if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Submitted draw failed: %s", esp_err_to_name(ret));
+        }
+
+        if (ili9488->delete_pending)
+        {
+            // The panel has been deleted by a callback of this request, the
+            // requests still queued are discarded.
+            while (panel_ili9488_dequeue_draw(ili9488, &request))
+            {
+                if (request.done != NULL)
+                {
+                    *request.result = ESP_ERR_INVALID_STATE;
+                    xSemaphoreGive(request.done);
+                }
+            }
+            panel_ili9488_free(ili9488);
+            vTaskDelete(NULL);
         }
-        free(ili9488);
     }
-    return ret;
 }
 
-esp_err_t esp_lcd_new_panel_ili9488(
-    const esp_lcd_panel_io_handle_t io,
-    const esp_lcd_panel_dev_config_t *panel_dev_config,
-    const size_t buffer_size,
-    esp_lcd_panel_handle_t *ret_panel)
+esp_err_t esp_lcd_ili9488_start_draw_task(
+    esp_lcd_panel_handle_t panel,
+    const esp_lcd_ili9488_draw_task_config_t *config)
 {
-    return esp_lcd_new_panel_ili9488_internal(io, panel_dev_config, buffer_size, false, ret_panel);
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    ESP_RETURN_ON_FALSE(ili9488->draw_task == NULL, ESP_ERR_INVALID_STATE, TAG,
+                        "draw task is already running");
+    esp_lcd_ili9488_draw_task_config_t defaults =
+    {
+        .queue_size = ILI9488_DRAW_TASK_QUEUE_SIZE,
+        .task_stack_size = ILI9488_DRAW_TASK_STACK_SIZE,
+        .task_priority = ILI9488_DRAW_TASK_PRIORITY,
+        .task_core_id = -1,
+    };
+    if (config == NULL)
+    {
+        config = &defaults;
+    }
+    // The queue positions wrap around, a power of two size keeps the slot
+    // index consistent when they do.
+    ESP_RETURN_ON_FALSE(config->queue_size > 0 &&
+                        (config->queue_size & (config->queue_size - 1)) == 0,
+                        ESP_ERR_INVALID_ARG, TAG,
+                        "queue size must be a power of two");
+
+    ili9488->draw_queue =
+        calloc(config->queue_size, sizeof(ili9488_draw_slot_t));
+    ESP_RETURN_ON_FALSE(ili9488->draw_queue, ESP_ERR_NO_MEM, TAG,
+                        "no mem for draw queue");
+    ili9488->draw_queue_space =
+        xSemaphoreCreateCounting(config->queue_size, config->queue_size);
+    ili9488->draw_queue_items = xSemaphoreCreateCounting(config->queue_size, 0);
+    if (ili9488->draw_queue_space == NULL || ili9488->draw_queue_items == NULL)
+    {
+        panel_ili9488_free_draw_queue(ili9488);
+        ESP_LOGE(TAG, "no mem for draw queue semaphores");
+        return ESP_ERR_NO_MEM;
+    }
+    ili9488->draw_queue_size = config->queue_size;
+    for (unsigned idx = 0; idx < ili9488->draw_queue_size; idx++)
+    {
+        atomic_init(&ili9488->draw_queue[idx].sequence, idx);
+    }
+    atomic_init(&ili9488->draw_queue_head, 0);
+    ili9488->draw_queue_tail = 0;
+
+    if (xTaskCreatePinnedToCore(
+            panel_ili9488_draw_task, "ili9488_draw", config->task_stack_size,
+            ili9488, config->task_priority, &ili9488->draw_task,
+            config->task_core_id < 0 ? tskNO_AFFINITY : config->task_core_id)
+        != pdPASS)
+    {
+        ili9488->draw_task = NULL;
+        panel_ili9488_free_draw_queue(ili9488);
+        ESP_LOGE(TAG, "Unable to create draw task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
 }
 
-esp_err_t esp_lcd_new_panel_ili9488_ips(
-    const esp_lcd_panel_io_handle_t io,
-    const esp_lcd_panel_dev_config_t *panel_dev_config,
-    const size_t buffer_size,
-    esp_lcd_panel_handle_t *ret_panel)
+esp_err_t esp_lcd_ili9488_submit_draw(
+    esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end,
+    int y_end, const void *color_data,
+    esp_lcd_ili9488_draw_done_cb_t callback, void *user_ctx)
 {
-    return esp_lcd_new_panel_ili9488_internal(io, panel_dev_config, buffer_size, true, ret_panel);
+    ESP_RETURN_ON_FALSE(panel && color_data && x_start < x_end &&
+                        y_start < y_end, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid argument");
+    ili9488_panel_t *ili9488 = __containerof(panel, ili9488_panel_t, base);
+    ESP_RETURN_ON_FALSE(ili9488->draw_task, ESP_ERR_INVALID_STATE, TAG,
+                        "draw task has not been started");
+    ili9488_draw_request_t request =
+    {
+        .type = ILI9488_DRAW_REQUEST_BITMAP_ASYNC,
+        .x_start = x_start, .y_start = y_start,
+        .x_end = x_end, .y_end = y_end,
+        .color_data = color_data,
+        .callback = callback, .user_ctx = user_ctx
+    };
+    ESP_RETURN_ON_FALSE(panel_ili9488_enqueue_draw(ili9488, &request, 0),
+                        ESP_ERR_NO_MEM, TAG, "draw queue is full");
+    return ESP_OK;
 }
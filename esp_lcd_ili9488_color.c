@@ -0,0 +1,366 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_lcd_ili9488_color.h>
+#include <sdkconfig.h>
+
+#if CONFIG_ILI9488_RGB666_PIE
+// Implemented in esp_lcd_ili9488_color_pie.S using the ESP32-S3 PIE
+// instructions. These convert blocks of 16 pixels to 32-bit aligned output
+// and read up to 16 bytes past the last block.
+void ili9488_rgb565_to_rgb666_pie(uint32_t *out, const uint16_t *in,
+                                  size_t blocks);
+void ili9488_rgb565_swapped_to_rgb666_pie(uint32_t *out, const uint16_t *in,
+                                          size_t blocks);
+#endif
+
+/**
+ * @brief Converts RGB565 color data to the RGB666 format used by the ILI9488
+ * when using 18-bit color mode.
+ *
+ * Each pixel is expanded to three bytes with the color data in the upper six
+ * bits, the lower two bits are not used by the ILI9488. When @param swap_bytes
+ * is true the two bytes of each RGB565 pixel are swapped before conversion.
+ */
+static void ili9488_rgb565_to_rgb666_scalar(
+    uint8_t *buf, const uint16_t *raw_color_data, size_t pixels,
+    bool swap_bytes)
+{
+    for (uint32_t i = 0, pixel_index = 0; i < pixels; i++) {
+        uint16_t color = raw_color_data[i];
+        if (swap_bytes)
+        {
+            color = (color >> 8) | (color << 8);
+        }
+        buf[pixel_index++] = (uint8_t) (((color & 0xF800) >> 8) |
+                                        ((color & 0x8000) >> 13));
+        buf[pixel_index++] = (uint8_t) ((color & 0x07E0) >> 3);
+        buf[pixel_index++] = (uint8_t) (((color & 0x001F) << 3) |
+                                        ((color & 0x0010) >> 2));
+    }
+}
+
+// Number of pixels which have to be converted using byte stores before buf is
+// 32-bit aligned. Each RGB666 pixel is three bytes, so this is at most three
+// pixels.
+static inline __attribute__((always_inline)) size_t ili9488_rgb666_lead_pixels(
+    const uint8_t *buf, size_t pixels)
+{
+    size_t lead = (uintptr_t)buf & 0x3;
+    return lead < pixels ? lead : pixels;
+}
+
+// Extracts the red, green and blue components of two RGB565 pixels packed in
+// a 32-bit word, the result for each pixel is in the low byte of each 16-bit
+// half in the same format as ili9488_rgb565_to_rgb666_scalar generates.
+#define RGB565X2_RED(pixels)                                            \
+    ((((pixels) >> 8) & 0x00F800F8) | (((pixels) >> 13) & 0x00040004))
+#define RGB565X2_GREEN(pixels)                                          \
+    (((pixels) >> 3) & 0x00FC00FC)
+#define RGB565X2_BLUE(pixels)                                           \
+    ((((pixels) << 3) & 0x00F800F8) | (((pixels) >> 2) & 0x00040004))
+#define RGB565X2_SWAP(pixels)                                           \
+    ((((pixels) >> 8) & 0x00FF00FF) | (((pixels) << 8) & 0xFF00FF00))
+
+/**
+ * @brief Converts four RGB565 pixels (two 32-bit words) into twelve bytes of
+ * RGB666 color data which are stored as three 32-bit words.
+ */
+static inline __attribute__((always_inline)) void ili9488_rgb565x4_to_rgb666(
+    uint32_t *out, uint32_t pixels01, uint32_t pixels23, bool swap_bytes)
+{
+    if (swap_bytes)
+    {
+        pixels01 = RGB565X2_SWAP(pixels01);
+        pixels23 = RGB565X2_SWAP(pixels23);
+    }
+
+    uint32_t red01 = RGB565X2_RED(pixels01);
+    uint32_t green01 = RGB565X2_GREEN(pixels01);
+    uint32_t blue01 = RGB565X2_BLUE(pixels01);
+    uint32_t red23 = RGB565X2_RED(pixels23);
+    uint32_t green23 = RGB565X2_GREEN(pixels23);
+    uint32_t blue23 = RGB565X2_BLUE(pixels23);
+
+    // Output bytes: R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3
+    out[0] = (red01 & 0xFF) | ((green01 & 0xFF) << 8) | (blue01 << 16) |
+             ((red01 << 8) & 0xFF000000);
+    out[1] = (green01 >> 16) | (blue01 >> 8) | (red23 << 16) | (green23 << 24);
+    out[2] = (blue23 & 0xFF) | (red23 >> 8) | (green23 & 0x00FF0000) |
+             ((blue23 << 8) & 0xFF000000);
+}
+
+#undef RGB565X2_RED
+#undef RGB565X2_GREEN
+#undef RGB565X2_BLUE
+
+/**
+ * @brief Converts RGB565 color data to RGB666 reading two pixels per 32-bit
+ * load and writing four pixels as three 32-bit stores.
+ *
+ * With CONFIG_ILI9488_RGB666_PIE the bulk of the pixels is converted by the
+ * PIE kernel instead, the remaining pixels use the code below.
+ *
+ * When the color data is not 32-bit aligned the first pixel is carried over
+ * into the next load so that all loads remain aligned. Any remaining pixels,
+ * and the pixels preceding the first 32-bit aligned output position, are
+ * converted using ili9488_rgb565_to_rgb666_scalar.
+ */
+static inline __attribute__((always_inline)) void ili9488_rgb565_to_rgb666(
+    uint8_t *buf, const uint16_t *raw_color_data, size_t pixels,
+    bool swap_bytes)
+{
+    size_t lead = ili9488_rgb666_lead_pixels(buf, pixels);
+    ili9488_rgb565_to_rgb666_scalar(buf, raw_color_data, lead, swap_bytes);
+    buf += lead * 3;
+    raw_color_data += lead;
+    pixels -= lead;
+
+#if CONFIG_ILI9488_RGB666_PIE
+    // The PIE kernel reads ahead of the pixels it converts, at least 8
+    // pixels are left for the word kernel.
+    if (pixels >= 16 + 8)
+    {
+        size_t blocks = (pixels - 8) / 16;
+        if (swap_bytes)
+        {
+            ili9488_rgb565_swapped_to_rgb666_pie((uint32_t *)buf,
+                                                 raw_color_data, blocks);
+        }
+        else
+        {
+            ili9488_rgb565_to_rgb666_pie((uint32_t *)buf, raw_color_data,
+                                         blocks);
+        }
+        buf += blocks * 16 * 3;
+        raw_color_data += blocks * 16;
+        pixels -= blocks * 16;
+    }
+#endif
+
+    uint32_t *out = (uint32_t *)buf;
+    size_t converted = 0;
+
+    if (((uintptr_t)raw_color_data & 0x3) == 0)
+    {
+        const uint32_t *in = (const uint32_t *)raw_color_data;
+        for (; converted + 4 <= pixels; converted += 4)
+        {
+            ili9488_rgb565x4_to_rgb666(out, in[0], in[1], swap_bytes);
+            in += 2;
+            out += 3;
+        }
+    }
+    else if (pixels > 4)
+    {
+        // The first pixel is in the upper half of the preceding word, carry
+        // it forward and combine it with the following aligned loads. One
+        // pixel more than is converted by each iteration has to be available.
+        const uint32_t *in = (const uint32_t *)(raw_color_data + 1);
+        uint32_t carry = raw_color_data[0];
+        for (; converted + 5 <= pixels; converted += 4)
+        {
+            uint32_t pixels12 = in[0];
+            uint32_t pixels34 = in[1];
+            ili9488_rgb565x4_to_rgb666(out, carry | (pixels12 << 16),
+                                       (pixels12 >> 16) | (pixels34 << 16),
+                                       swap_bytes);
+            carry = pixels34 >> 16;
+            in += 2;
+            out += 3;
+        }
+    }
+
+    ili9488_rgb565_to_rgb666_scalar(buf + converted * 3,
+                                    raw_color_data + converted,
+                                    pixels - converted, swap_bytes);
+}
+
+// Packs two RGB565 pixels held in a 32-bit word into a single byte of 3-bit
+// color data using the most significant bit of each color component. The
+// first pixel is stored in bits 5..3 and the second in bits 2..0.
+#define RGB565X2_TO_RGB111(pixels)                                      \
+    ((((pixels) >> 10) & 0x20) | (((pixels) >> 6) & 0x10) |             \
+     (((pixels) >> 1) & 0x08) | (((pixels) >> 29) & 0x04) |             \
+     (((pixels) >> 25) & 0x02) | (((pixels) >> 20) & 0x01))
+
+/**
+ * @brief Converts RGB565 color data to the 3-bit format used by the ILI9488,
+ * two pixels are packed into each byte.
+ *
+ * When the color data is 32-bit aligned eight pixels are converted per
+ * iteration and stored as a single 32-bit word when @param buf is also 32-bit
+ * aligned, otherwise two pixels are converted per byte store. When
+ * @param pixels is odd the
+ * lower three bits of the last byte are zero.
+ */
+static inline __attribute__((always_inline)) void ili9488_rgb565_to_rgb111(
+    uint8_t *buf, const uint16_t *raw_color_data, size_t pixels,
+    bool swap_bytes)
+{
+    size_t converted = 0;
+    if (((uintptr_t)raw_color_data & 0x3) == 0 && ((uintptr_t)buf & 0x3) == 0)
+    {
+        const uint32_t *in = (const uint32_t *)raw_color_data;
+        uint32_t *out = (uint32_t *)buf;
+        for (; converted + 8 <= pixels; converted += 8)
+        {
+            uint32_t pixels01 = in[0];
+            uint32_t pixels23 = in[1];
+            uint32_t pixels45 = in[2];
+            uint32_t pixels67 = in[3];
+            if (swap_bytes)
+            {
+                pixels01 = RGB565X2_SWAP(pixels01);
+                pixels23 = RGB565X2_SWAP(pixels23);
+                pixels45 = RGB565X2_SWAP(pixels45);
+                pixels67 = RGB565X2_SWAP(pixels67);
+            }
+            *out++ = RGB565X2_TO_RGB111(pixels01) |
+                     (RGB565X2_TO_RGB111(pixels23) << 8) |
+                     (RGB565X2_TO_RGB111(pixels45) << 16) |
+                     (RGB565X2_TO_RGB111(pixels67) << 24);
+            in += 4;
+        }
+    }
+
+    for (; converted < pixels; converted += 2)
+    {
+        uint32_t pixels01 = raw_color_data[converted];
+        if (converted + 1 < pixels)
+        {
+            pixels01 |= (uint32_t)raw_color_data[converted + 1] << 16;
+        }
+        if (swap_bytes)
+        {
+            pixels01 = RGB565X2_SWAP(pixels01);
+        }
+        buf[converted / 2] = RGB565X2_TO_RGB111(pixels01);
+    }
+}
+
+#undef RGB565X2_SWAP
+#undef RGB565X2_TO_RGB111
+
+void esp_lcd_ili9488_rgb565_to_rgb666(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    ili9488_rgb565_to_rgb666(buf, (const uint16_t *)color_data, pixels, false);
+}
+
+void esp_lcd_ili9488_rgb565_swapped_to_rgb666(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    ili9488_rgb565_to_rgb666(buf, (const uint16_t *)color_data, pixels, true);
+}
+
+void esp_lcd_ili9488_rgb888_to_rgb666(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    const uint8_t *raw_color_data = (const uint8_t *)color_data;
+    size_t converted = ili9488_rgb666_lead_pixels(buf, pixels);
+
+    // The ILI9488 only uses the upper six bits of each byte so the conversion
+    // only needs to reorder the bytes. When the color data is 32-bit aligned
+    // four pixels are processed per iteration, the leading pixels before the
+    // first 32-bit aligned output position are converted below.
+    for (size_t i = 0; i < converted * 3; i += 3)
+    {
+        buf[i] = raw_color_data[i + 2];
+        buf[i + 1] = raw_color_data[i + 1];
+        buf[i + 2] = raw_color_data[i];
+    }
+    buf += converted * 3;
+    raw_color_data += converted * 3;
+    pixels -= converted;
+    converted = 0;
+
+    if (((uintptr_t)raw_color_data & 0x3) == 0)
+    {
+        const uint32_t *in = (const uint32_t *)raw_color_data;
+        uint32_t *out = (uint32_t *)buf;
+        for (; converted + 4 <= pixels; converted += 4)
+        {
+            // Input bytes:  B0 G0 R0 B1 | G1 R1 B2 G2 | R2 B3 G3 R3
+            // Output bytes: R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3
+            uint32_t in0 = in[0];
+            uint32_t in1 = in[1];
+            uint32_t in2 = in[2];
+            out[0] = ((in0 >> 16) & 0xFF) | (in0 & 0xFF00) |
+                     ((in0 & 0xFF) << 16) | ((in1 << 16) & 0xFF000000);
+            out[1] = (in1 & 0xFF) | ((in0 >> 16) & 0xFF00) |
+                     ((in2 & 0xFF) << 16) | (in1 & 0xFF000000);
+            out[2] = ((in1 >> 16) & 0xFF) | ((in2 >> 16) & 0xFF00) |
+                     (in2 & 0xFF0000) | ((in2 << 16) & 0xFF000000);
+            in += 3;
+            out += 3;
+        }
+    }
+
+    for (size_t i = converted * 3; i < pixels * 3; i += 3)
+    {
+        buf[i] = raw_color_data[i + 2];
+        buf[i + 1] = raw_color_data[i + 1];
+        buf[i + 2] = raw_color_data[i];
+    }
+}
+
+void esp_lcd_ili9488_xrgb8888_to_rgb666(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    const uint32_t *raw_color_data = (const uint32_t *)color_data;
+    size_t converted = ili9488_rgb666_lead_pixels(buf, pixels);
+
+    // Convert the pixels before the first 32-bit aligned output position
+    // using byte stores.
+    for (size_t i = 0; i < converted; i++)
+    {
+        uint32_t color = *raw_color_data++;
+        *buf++ = (uint8_t) (color >> 16);
+        *buf++ = (uint8_t) (color >> 8);
+        *buf++ = (uint8_t) color;
+    }
+    pixels -= converted;
+    converted = 0;
+
+    uint32_t *out = (uint32_t *)buf;
+    for (; converted + 4 <= pixels; converted += 4)
+    {
+        // Output bytes: R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3
+        uint32_t pixel0 = raw_color_data[0];
+        uint32_t pixel1 = raw_color_data[1];
+        uint32_t pixel2 = raw_color_data[2];
+        uint32_t pixel3 = raw_color_data[3];
+        out[0] = ((pixel0 >> 16) & 0xFF) | (pixel0 & 0xFF00) |
+                 ((pixel0 & 0xFF) << 16) | ((pixel1 << 8) & 0xFF000000);
+        out[1] = ((pixel1 >> 8) & 0xFF) | ((pixel1 & 0xFF) << 8) |
+                 (pixel2 & 0xFF0000) | ((pixel2 & 0xFF00) << 16);
+        out[2] = (pixel2 & 0xFF) | ((pixel3 >> 8) & 0xFF00) |
+                 ((pixel3 << 8) & 0xFF0000) | (pixel3 << 24);
+        raw_color_data += 4;
+        out += 3;
+    }
+
+    for (size_t i = converted * 3; converted < pixels; converted++)
+    {
+        uint32_t color = *raw_color_data++;
+        buf[i++] = (uint8_t) (color >> 16);
+        buf[i++] = (uint8_t) (color >> 8);
+        buf[i++] = (uint8_t) color;
+    }
+}
+
+void esp_lcd_ili9488_rgb565_to_rgb111(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    ili9488_rgb565_to_rgb111(buf, (const uint16_t *)color_data, pixels, false);
+}
+
+void esp_lcd_ili9488_rgb565_swapped_to_rgb111(
+    uint8_t *buf, const void *color_data, size_t pixels)
+{
+    ili9488_rgb565_to_rgb111(buf, (const uint16_t *)color_data, pixels, true);
+}
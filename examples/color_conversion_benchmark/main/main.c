@@ -0,0 +1,208 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_lcd_ili9488_color.h>
+#include <inttypes.h>
+#include <sdkconfig.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const size_t DISPLAY_HORIZONTAL_PIXELS = 320;
+static const size_t DISPLAY_VERTICAL_PIXELS = 480;
+
+// Matches the LV_BUFFER_SIZE used by the LVGL example.
+static const size_t LVGL_BUFFER_LINES = 25;
+
+// Number of pixels to convert for each benchmark case, the number of
+// iterations is derived from this.
+static const size_t PIXELS_PER_CASE = 4 * 1000 * 1000;
+
+typedef void (*conversion_fn_t)(uint8_t *buf, const void *color_data,
+                                size_t pixels);
+
+typedef struct
+{
+    const char *name;
+    conversion_fn_t convert;
+    size_t bytes_per_pixel;
+    // Size of each converted pixel, RGB666 uses 24 bits and the 3-bit color
+    // mode packs two pixels per byte.
+    size_t output_bits_per_pixel;
+    // Per-pixel conversion the output is compared with before measuring, or
+    // NULL when there is none.
+    conversion_fn_t reference;
+} conversion_kernel_t;
+
+typedef struct
+{
+    const char *name;
+    size_t width;
+    size_t height;
+    // Offset (in pixels) applied to the source color data to measure the
+    // unaligned code paths.
+    size_t offset;
+} benchmark_case_t;
+
+// Original per-pixel conversion loop from draw_bitmap, used as the baseline
+// for comparison.
+static void baseline_rgb565_to_rgb666(uint8_t *buf, const void *color_data,
+                                      size_t pixels)
+{
+    const uint16_t *raw_color_data = (const uint16_t *)color_data;
+    for (uint32_t i = 0, pixel_index = 0; i < pixels; i++) {
+        buf[pixel_index++] = (uint8_t) (((raw_color_data[i] & 0xF800) >> 8) |
+                                        ((raw_color_data[i] & 0x8000) >> 13));
+        buf[pixel_index++] = (uint8_t) ((raw_color_data[i] & 0x07E0) >> 3);
+        buf[pixel_index++] = (uint8_t) (((raw_color_data[i] & 0x001F) << 3) |
+                                        ((raw_color_data[i] & 0x0010) >> 2));
+    }
+}
+
+// Baseline loop for color data with the two bytes of each pixel swapped.
+static void baseline_rgb565_swapped_to_rgb666(uint8_t *buf,
+                                              const void *color_data,
+                                              size_t pixels)
+{
+    const uint8_t *raw_color_data = (const uint8_t *)color_data;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        uint16_t color = (raw_color_data[i * 2] << 8) |
+                         raw_color_data[i * 2 + 1];
+        baseline_rgb565_to_rgb666(buf + i * 3, &color, 1);
+    }
+}
+
+static const conversion_kernel_t KERNELS[] =
+{
+    { "RGB565 baseline", baseline_rgb565_to_rgb666, 2, 24, NULL },
+    { "RGB565", esp_lcd_ili9488_rgb565_to_rgb666, 2, 24,
+      baseline_rgb565_to_rgb666 },
+    { "RGB565 swapped", esp_lcd_ili9488_rgb565_swapped_to_rgb666, 2, 24,
+      baseline_rgb565_swapped_to_rgb666 },
+    { "RGB888", esp_lcd_ili9488_rgb888_to_rgb666, 3, 24, NULL },
+    { "XRGB8888", esp_lcd_ili9488_xrgb8888_to_rgb666, 4, 24, NULL },
+    { "RGB565 to 3-bit", esp_lcd_ili9488_rgb565_to_rgb111, 2, 3, NULL },
+};
+
+static int64_t time_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void run_benchmark(const conversion_kernel_t *kernel,
+                          const benchmark_case_t *bench)
+{
+    size_t pixels = bench->width * bench->height;
+    size_t offset = bench->offset * kernel->bytes_per_pixel;
+
+    // XRGB8888 color data must always be 32-bit aligned.
+    if (offset % 4 && kernel->bytes_per_pixel == 4)
+    {
+        offset = 0;
+    }
+
+    uint8_t *source = malloc(pixels * kernel->bytes_per_pixel + offset);
+    uint8_t *buf = malloc(pixels * 3);
+    if (source == NULL || buf == NULL)
+    {
+        printf("%-16s %-30s skipped, not enough memory\n", kernel->name,
+               bench->name);
+        free(source);
+        free(buf);
+        return;
+    }
+
+    uint32_t seed = 0x12345678;
+    for (size_t i = 0; i < pixels * kernel->bytes_per_pixel + offset; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        source[i] = (uint8_t)(seed >> 24);
+    }
+
+    if (kernel->reference != NULL)
+    {
+        uint8_t *expected = malloc(pixels * 3);
+        if (expected != NULL)
+        {
+            kernel->reference(expected, source + offset, pixels);
+            kernel->convert(buf, source + offset, pixels);
+            bool matches = memcmp(buf, expected, pixels * 3) == 0;
+            free(expected);
+            if (!matches)
+            {
+                printf("%-16s %-30s output does not match the baseline\n",
+                       kernel->name, bench->name);
+                free(source);
+                free(buf);
+                return;
+            }
+        }
+    }
+
+    size_t iterations = PIXELS_PER_CASE / pixels;
+    if (iterations == 0)
+    {
+        iterations = 1;
+    }
+
+    int64_t start = time_us();
+    for (size_t iteration = 0; iteration < iterations; iteration++)
+    {
+        kernel->convert(buf, source + offset, pixels);
+    }
+    int64_t elapsed = time_us() - start;
+    if (elapsed <= 0)
+    {
+        elapsed = 1;
+    }
+
+    double total_pixels = (double)pixels * iterations;
+    double mpix_per_second = total_pixels / elapsed;
+    double input_mb_per_second =
+        total_pixels * kernel->bytes_per_pixel / elapsed;
+    double output_mb_per_second =
+        total_pixels * kernel->output_bits_per_pixel / 8 / elapsed;
+    printf("%-16s %-30s %8.2f MPix/s %8.2f MB/s in %8.2f MB/s out\n",
+           kernel->name, bench->name, mpix_per_second, input_mb_per_second,
+           output_mb_per_second);
+
+    free(source);
+    free(buf);
+}
+
+void app_main(void)
+{
+    const benchmark_case_t cases[] =
+    {
+        { "full frame (320x480)", DISPLAY_HORIZONTAL_PIXELS,
+          DISPLAY_VERTICAL_PIXELS, 0 },
+        { "LVGL buffer (320x25)", DISPLAY_HORIZONTAL_PIXELS,
+          LVGL_BUFFER_LINES, 0 },
+        { "single row (320x1)", DISPLAY_HORIZONTAL_PIXELS, 1, 0 },
+        { "odd width, unaligned (317x25)", DISPLAY_HORIZONTAL_PIXELS - 3,
+          LVGL_BUFFER_LINES, 1 },
+    };
+
+    printf("ILI9488 color conversion benchmark, %zu pixels per case\n",
+           PIXELS_PER_CASE);
+#if CONFIG_ILI9488_RGB666_PIE
+    printf("RGB565 to RGB666 conversion uses the PIE kernel\n");
+#endif
+    for (size_t kernel = 0; kernel < sizeof(KERNELS) / sizeof(KERNELS[0]);
+         kernel++)
+    {
+        for (size_t bench = 0; bench < sizeof(cases) / sizeof(cases[0]);
+             bench++)
+        {
+            run_benchmark(&KERNELS[kernel], &cases[bench]);
+        }
+    }
+    printf("Benchmark complete\n");
+}
@@ -88,13 +88,14 @@ static void update_meter_value(void *indic, int32_t v)
     lv_meter_set_indicator_end_value(meter, indic, v);
 }
 
-static bool notify_lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io,
-    esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static bool notify_lvgl_flush_ready(esp_lcd_panel_handle_t panel, void *user_ctx)
 {
     lv_disp_drv_t *disp_driver = (lv_disp_drv_t *)user_ctx;
     lv_disp_flush_ready(disp_driver);
     return false;
 }
+#endif
 
 static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
@@ -105,6 +106,12 @@ static void lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     int offsety1 = area->y1;
     int offsety2 = area->y2;
     esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+    // Without draw done callbacks a draw can span several color transfers,
+    // wait for all of them before handing the buffer back to LVGL.
+    esp_lcd_ili9488_wait_idle(panel_handle, 0);
+    lv_disp_flush_ready(drv);
+#endif
 }
 
 static void IRAM_ATTR lvgl_tick_cb(void *param)
@@ -193,8 +200,6 @@ void initialize_display()
         .spi_mode = 0,
         .pclk_hz = DISPLAY_REFRESH_HZ,
         .trans_queue_depth = DISPLAY_SPI_QUEUE_LEN,
-        .on_color_trans_done = notify_lvgl_flush_ready,
-        .user_ctx = &lv_disp_drv,
         .lcd_cmd_bits = DISPLAY_COMMAND_BITS,
         .lcd_param_bits = DISPLAY_PARAMETER_BITS,
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5,4,0)
@@ -241,6 +246,12 @@ void initialize_display()
 
     ESP_ERROR_CHECK(esp_lcd_panel_reset(lcd_handle));
     ESP_ERROR_CHECK(esp_lcd_panel_init(lcd_handle));
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    // Notify LVGL once all color data of a flush has been sent rather than
+    // after each color transfer.
+    ESP_ERROR_CHECK(esp_lcd_ili9488_register_draw_done_callback(
+        lcd_handle, notify_lvgl_flush_ready, &lv_disp_drv));
+#endif
     ESP_ERROR_CHECK(esp_lcd_panel_invert_color(lcd_handle, false));
     ESP_ERROR_CHECK(esp_lcd_panel_swap_xy(lcd_handle, false));
     ESP_ERROR_CHECK(esp_lcd_panel_mirror(lcd_handle, true, false));
@@ -63,12 +63,14 @@ static const char *TAG = "example";
 
 extern void example_lvgl_demo_ui(lv_obj_t *scr);
 
-static bool example_notify_lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static bool example_notify_lvgl_flush_ready(esp_lcd_panel_handle_t panel, void *user_ctx)
 {
     lv_disp_drv_t *disp_driver = (lv_disp_drv_t *)user_ctx;
     lv_disp_flush_ready(disp_driver);
     return false;
 }
+#endif
 
 static void example_lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
@@ -79,6 +81,11 @@ static void example_lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_
     int offsety2 = area->y2;
     // copy a buffer's content to a specific area of the display
     esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+    // without draw done callbacks a draw can span several color transfers, wait for all of them before handing the buffer back to LVGL
+    esp_lcd_ili9488_wait_idle(panel_handle, 0);
+    lv_disp_flush_ready(drv);
+#endif
 }
 
 static void example_increase_lvgl_tick(void *arg)
@@ -143,8 +150,6 @@ void app_main(void)
             .dc_dummy_level = 0,
             .dc_data_level = 1,
         },
-        .on_color_trans_done = example_notify_lvgl_flush_ready,
-        .user_ctx = &disp_drv,
         .lcd_cmd_bits = EXAMPLE_LCD_CMD_BITS,
         .lcd_param_bits = EXAMPLE_LCD_PARAM_BITS,
     };
@@ -165,6 +170,10 @@ void app_main(void)
 
     esp_lcd_panel_reset(panel_handle);
     esp_lcd_panel_init(panel_handle);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    // notify LVGL once all color data of a flush has been sent, this replaces the on_color_trans_done callback of the panel IO
+    ESP_ERROR_CHECK(esp_lcd_ili9488_register_draw_done_callback(panel_handle, example_notify_lvgl_flush_ready, &disp_drv));
+#endif
     esp_lcd_panel_invert_color(panel_handle, true);
     // the gap is LCD panel specific, even panels with the same driver IC, can have different gap value
     esp_lcd_panel_set_gap(panel_handle, 0, 20);
@@ -0,0 +1,339 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_check.h>
+#include <esp_lcd_panel_interface.h>
+#include <esp_lcd_panel_io_interface.h>
+#include <esp_lcd_panel_io_mock.h>
+#include <esp_lcd_panel_ops.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+
+static const char *TAG = "lcd_io_mock";
+
+// Color transfer which has been queued but not completed, the checksum of the
+// color data is used to detect changes before the transfer has completed.
+typedef struct
+{
+    const uint8_t *color;
+    size_t color_size;
+    uint32_t checksum;
+} panel_io_mock_transfer_t;
+
+typedef struct
+{
+    esp_lcd_panel_io_t base;
+    uint8_t *bytes;
+    size_t buffer_size;
+    size_t length;
+    esp_lcd_panel_io_mock_transaction_t *transactions;
+    size_t max_transactions;
+    size_t count;
+    panel_io_mock_transfer_t *transfers;
+    size_t transfers_queued;
+    size_t modified_transfers;
+    esp_err_t tx_color_result;
+    int failing_cmd;
+    esp_err_t tx_param_result;
+    esp_lcd_panel_io_color_trans_done_cb_t on_color_trans_done;
+    void *user_ctx;
+} lcd_panel_io_mock_t;
+
+static uint32_t panel_io_mock_checksum(const uint8_t *data, size_t size)
+{
+    uint32_t checksum = 0x811C9DC5;
+    for (size_t idx = 0; idx < size; idx++)
+    {
+        checksum = (checksum ^ data[idx]) * 0x01000193;
+    }
+    return checksum;
+}
+
+static esp_err_t panel_io_mock_record(
+    lcd_panel_io_mock_t *mock, int lcd_cmd, bool color, const void *data,
+    size_t size)
+{
+    ESP_RETURN_ON_FALSE(mock->count < mock->max_transactions &&
+                        mock->length + 1 + size <= mock->buffer_size,
+                        ESP_ERR_NO_MEM, TAG, "recording buffer is full");
+    esp_lcd_panel_io_mock_transaction_t *transaction =
+        &mock->transactions[mock->count++];
+    transaction->lcd_cmd = lcd_cmd;
+    transaction->color = color;
+    transaction->offset = mock->length;
+    transaction->length = size;
+    mock->bytes[mock->length++] = (uint8_t)lcd_cmd;
+    if (size > 0)
+    {
+        memcpy(mock->bytes + mock->length, data, size);
+        mock->length += size;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t panel_io_mock_rx_param(
+    esp_lcd_panel_io_t *io, int lcd_cmd, void *param, size_t param_size)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    esp_lcd_panel_io_mock_complete_transfers(io);
+    if (param_size > 0)
+    {
+        memset(param, 0, param_size);
+    }
+    return panel_io_mock_record(mock, lcd_cmd, false, NULL, 0);
+}
+
+static esp_err_t panel_io_mock_tx_param(
+    esp_lcd_panel_io_t *io, int lcd_cmd, const void *param, size_t param_size)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    esp_lcd_panel_io_mock_complete_transfers(io);
+    if (lcd_cmd == mock->failing_cmd && mock->tx_param_result != ESP_OK)
+    {
+        return mock->tx_param_result;
+    }
+    return panel_io_mock_record(mock, lcd_cmd, false, param, param_size);
+}
+
+static esp_err_t panel_io_mock_tx_color(
+    esp_lcd_panel_io_t *io, int lcd_cmd, const void *color, size_t color_size)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    if (mock->tx_color_result != ESP_OK)
+    {
+        return mock->tx_color_result;
+    }
+    ESP_RETURN_ON_ERROR(
+        panel_io_mock_record(mock, lcd_cmd, true, color, color_size), TAG,
+        "record color data failed");
+    ESP_RETURN_ON_FALSE(mock->transfers_queued < mock->max_transactions,
+                        ESP_ERR_NO_MEM, TAG, "too many queued transfers");
+    panel_io_mock_transfer_t *transfer =
+        &mock->transfers[mock->transfers_queued++];
+    transfer->color = (const uint8_t *)color;
+    transfer->color_size = color_size;
+    transfer->checksum = panel_io_mock_checksum(color, color_size);
+    return ESP_OK;
+}
+
+static esp_err_t panel_io_mock_del(esp_lcd_panel_io_t *io)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    free(mock->bytes);
+    free(mock->transactions);
+    free(mock->transfers);
+    free(mock);
+    return ESP_OK;
+}
+
+static esp_err_t panel_io_mock_register_event_callbacks(
+    esp_lcd_panel_io_t *io, const esp_lcd_panel_io_callbacks_t *cbs,
+    void *user_ctx)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    mock->on_color_trans_done = cbs->on_color_trans_done;
+    mock->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_io_mock(const esp_lcd_panel_io_mock_config_t *config,
+                                    esp_lcd_panel_io_handle_t *ret_io)
+{
+    ESP_RETURN_ON_FALSE(config && ret_io && config->buffer_size > 0 &&
+                        config->max_transactions > 0, ESP_ERR_INVALID_ARG,
+                        TAG, "invalid argument");
+    lcd_panel_io_mock_t *mock =
+        (lcd_panel_io_mock_t *)calloc(1, sizeof(lcd_panel_io_mock_t));
+    ESP_RETURN_ON_FALSE(mock, ESP_ERR_NO_MEM, TAG, "no mem for mock panel IO");
+    mock->bytes = (uint8_t *)malloc(config->buffer_size);
+    mock->transactions = (esp_lcd_panel_io_mock_transaction_t *)calloc(
+        config->max_transactions, sizeof(esp_lcd_panel_io_mock_transaction_t));
+    mock->transfers = (panel_io_mock_transfer_t *)calloc(
+        config->max_transactions, sizeof(panel_io_mock_transfer_t));
+    if (mock->bytes == NULL || mock->transactions == NULL ||
+        mock->transfers == NULL)
+    {
+        panel_io_mock_del(&mock->base);
+        ESP_LOGE(TAG, "no mem for mock panel IO recording");
+        return ESP_ERR_NO_MEM;
+    }
+    mock->buffer_size = config->buffer_size;
+    mock->max_transactions = config->max_transactions;
+    mock->base.rx_param = panel_io_mock_rx_param;
+    mock->base.tx_param = panel_io_mock_tx_param;
+    mock->base.tx_color = panel_io_mock_tx_color;
+    mock->base.del = panel_io_mock_del;
+    mock->base.register_event_callbacks = panel_io_mock_register_event_callbacks;
+    *ret_io = &mock->base;
+    return ESP_OK;
+}
+
+const uint8_t *esp_lcd_panel_io_mock_get_bytes(esp_lcd_panel_io_handle_t io,
+                                               size_t *length)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    *length = mock->length;
+    return mock->bytes;
+}
+
+const esp_lcd_panel_io_mock_transaction_t *esp_lcd_panel_io_mock_get_transactions(
+    esp_lcd_panel_io_handle_t io, size_t *count)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    *count = mock->count;
+    return mock->transactions;
+}
+
+void esp_lcd_panel_io_mock_clear(esp_lcd_panel_io_handle_t io)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    mock->length = 0;
+    mock->count = 0;
+}
+
+size_t esp_lcd_panel_io_mock_complete_transfers(esp_lcd_panel_io_handle_t io)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    size_t completed = mock->transfers_queued;
+    for (size_t idx = 0; idx < completed; idx++)
+    {
+        const panel_io_mock_transfer_t *transfer = &mock->transfers[idx];
+        if (panel_io_mock_checksum(transfer->color, transfer->color_size) !=
+            transfer->checksum)
+        {
+            mock->modified_transfers++;
+        }
+    }
+    for (; mock->transfers_queued > 0; mock->transfers_queued--)
+    {
+        if (mock->on_color_trans_done != NULL)
+        {
+            esp_lcd_panel_io_event_data_t edata;
+            mock->on_color_trans_done(io, &edata, mock->user_ctx);
+        }
+    }
+    return completed;
+}
+
+void esp_lcd_panel_io_mock_set_tx_color_result(esp_lcd_panel_io_handle_t io,
+                                               esp_err_t result)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    mock->tx_color_result = result;
+}
+
+size_t esp_lcd_panel_io_mock_get_modified_transfers(esp_lcd_panel_io_handle_t io)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    return mock->modified_transfers;
+}
+
+void esp_lcd_panel_io_mock_set_tx_param_result(esp_lcd_panel_io_handle_t io,
+                                               int lcd_cmd, esp_err_t result)
+{
+    lcd_panel_io_mock_t *mock = __containerof(io, lcd_panel_io_mock_t, base);
+    mock->failing_cmd = lcd_cmd;
+    mock->tx_param_result = result;
+}
+
+// The functions below dispatch to the panel IO and panel implementations in
+// the same way as the esp_lcd component.
+
+esp_err_t esp_lcd_panel_io_rx_param(esp_lcd_panel_io_handle_t io, int lcd_cmd,
+                                    void *param, size_t param_size)
+{
+    ESP_RETURN_ON_FALSE(io, ESP_ERR_INVALID_ARG, TAG, "invalid io handle");
+    return io->rx_param(io, lcd_cmd, param, param_size);
+}
+
+esp_err_t esp_lcd_panel_io_tx_param(esp_lcd_panel_io_handle_t io, int lcd_cmd,
+                                    const void *param, size_t param_size)
+{
+    ESP_RETURN_ON_FALSE(io, ESP_ERR_INVALID_ARG, TAG, "invalid io handle");
+    return io->tx_param(io, lcd_cmd, param, param_size);
+}
+
+esp_err_t esp_lcd_panel_io_tx_color(esp_lcd_panel_io_handle_t io, int lcd_cmd,
+                                    const void *color, size_t color_size)
+{
+    ESP_RETURN_ON_FALSE(io, ESP_ERR_INVALID_ARG, TAG, "invalid io handle");
+    return io->tx_color(io, lcd_cmd, color, color_size);
+}
+
+esp_err_t esp_lcd_panel_io_del(esp_lcd_panel_io_handle_t io)
+{
+    ESP_RETURN_ON_FALSE(io, ESP_ERR_INVALID_ARG, TAG, "invalid io handle");
+    return io->del(io);
+}
+
+esp_err_t esp_lcd_panel_io_register_event_callbacks(
+    esp_lcd_panel_io_handle_t io, const esp_lcd_panel_io_callbacks_t *cbs,
+    void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(io && cbs, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return io->register_event_callbacks(io, cbs, user_ctx);
+}
+
+esp_err_t esp_lcd_panel_reset(esp_lcd_panel_handle_t panel)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->reset(panel);
+}
+
+esp_err_t esp_lcd_panel_init(esp_lcd_panel_handle_t panel)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->init(panel);
+}
+
+esp_err_t esp_lcd_panel_del(esp_lcd_panel_handle_t panel)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->del(panel);
+}
+
+esp_err_t esp_lcd_panel_draw_bitmap(esp_lcd_panel_handle_t panel, int x_start,
+                                    int y_start, int x_end, int y_end,
+                                    const void *color_data)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->draw_bitmap(panel, x_start, y_start, x_end, y_end,
+                              color_data);
+}
+
+esp_err_t esp_lcd_panel_mirror(esp_lcd_panel_handle_t panel, bool mirror_x,
+                               bool mirror_y)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->mirror(panel, mirror_x, mirror_y);
+}
+
+esp_err_t esp_lcd_panel_swap_xy(esp_lcd_panel_handle_t panel, bool swap_axes)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->swap_xy(panel, swap_axes);
+}
+
+esp_err_t esp_lcd_panel_set_gap(esp_lcd_panel_handle_t panel, int x_gap,
+                                int y_gap)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->set_gap(panel, x_gap, y_gap);
+}
+
+esp_err_t esp_lcd_panel_invert_color(esp_lcd_panel_handle_t panel,
+                                     bool invert_color_data)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->invert_color(panel, invert_color_data);
+}
+
+esp_err_t esp_lcd_panel_disp_on_off(esp_lcd_panel_handle_t panel, bool on_off)
+{
+    ESP_RETURN_ON_FALSE(panel, ESP_ERR_INVALID_ARG, TAG, "invalid panel handle");
+    return panel->disp_on_off(panel, on_off);
+}
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <driver/gpio.h>
+#include <esp_rom_gpio.h>
+
+// The host has no GPIOs, all calls succeed without any effect.
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return config != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler,
+                               void *args)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    return ESP_OK;
+}
+
+void esp_rom_gpio_pad_select_gpio(uint32_t iopad_num)
+{
+}
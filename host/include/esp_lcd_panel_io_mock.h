@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <esp_lcd_panel_io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Mock panel IO for running the ILI9488 driver on the host (linux target).
+ *
+ * Every command is recorded in the order it would be sent on the bus: the
+ * command byte followed by its parameters or color data. Color transfers are
+ * completed, and the on_color_trans_done callback invoked, when the next
+ * command is sent or esp_lcd_panel_io_mock_complete_transfers is called, the
+ * same way a real panel IO waits for queued color transfers before sending a
+ * command. Like the i80 panel IO, tx_color returns without waiting for the
+ * previously queued color transfers to complete.
+ */
+
+/**
+ * @brief Configuration of the mock panel IO.
+ */
+typedef struct
+{
+    size_t buffer_size;      /*!< Number of bytes which can be recorded */
+    size_t max_transactions; /*!< Number of commands which can be recorded */
+} esp_lcd_panel_io_mock_config_t;
+
+/**
+ * @brief Command recorded by the mock panel IO.
+ */
+typedef struct
+{
+    int lcd_cmd;     /*!< Command sent */
+    bool color;      /*!< Sent via tx_color rather than tx_param */
+    size_t offset;   /*!< Offset of the command byte in the recorded bytes */
+    size_t length;   /*!< Number of parameter / color data bytes */
+} esp_lcd_panel_io_mock_transaction_t;
+
+/**
+ * @brief Create a mock panel IO.
+ *
+ * @param[in] config Mock panel IO configuration
+ * @param[out] ret_io Returned panel IO handle
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NO_MEM        if out of memory
+ *          - ESP_OK                on success
+ *
+ * NOTE: When the recording buffers are full tx_param and tx_color fail with
+ * ESP_ERR_NO_MEM.
+ */
+esp_err_t esp_lcd_new_panel_io_mock(const esp_lcd_panel_io_mock_config_t *config,
+                                    esp_lcd_panel_io_handle_t *ret_io);
+
+/**
+ * @brief Retrieve the bytes recorded since the mock was created or cleared.
+ *
+ * @param[in] io Mock panel IO handle
+ * @param[out] length Receives the number of bytes recorded
+ * @return Recorded bytes
+ */
+const uint8_t *esp_lcd_panel_io_mock_get_bytes(esp_lcd_panel_io_handle_t io,
+                                               size_t *length);
+
+/**
+ * @brief Retrieve the commands recorded since the mock was created or
+ * cleared.
+ *
+ * @param[in] io Mock panel IO handle
+ * @param[out] count Receives the number of commands recorded
+ * @return Recorded commands
+ */
+const esp_lcd_panel_io_mock_transaction_t *esp_lcd_panel_io_mock_get_transactions(
+    esp_lcd_panel_io_handle_t io, size_t *count);
+
+/**
+ * @brief Discard all recorded bytes and commands.
+ *
+ * @param[in] io Mock panel IO handle
+ */
+void esp_lcd_panel_io_mock_clear(esp_lcd_panel_io_handle_t io);
+
+/**
+ * @brief Complete all queued color transfers.
+ *
+ * @param[in] io Mock panel IO handle
+ * @return Number of color transfers completed
+ */
+size_t esp_lcd_panel_io_mock_complete_transfers(esp_lcd_panel_io_handle_t io);
+
+/**
+ * @brief Retrieve the number of color transfers whose color data was
+ * modified before the transfer completed.
+ *
+ * @param[in] io Mock panel IO handle
+ * @return Number of modified transfers since the mock was created
+ */
+size_t esp_lcd_panel_io_mock_get_modified_transfers(esp_lcd_panel_io_handle_t io);
+
+/**
+ * @brief Set the result returned by the following tx_color calls, any
+ * result other than ESP_OK causes the color data to be discarded.
+ *
+ * @param[in] io Mock panel IO handle
+ * @param[in] result Result to return
+ */
+void esp_lcd_panel_io_mock_set_tx_color_result(esp_lcd_panel_io_handle_t io,
+                                               esp_err_t result);
+
+/**
+ * @brief Set the result returned by the following tx_param calls sending the
+ * given command, any result other than ESP_OK causes the command to be
+ * discarded.
+ *
+ * @param[in] io Mock panel IO handle
+ * @param[in] lcd_cmd Command to fail
+ * @param[in] result Result to return
+ */
+void esp_lcd_panel_io_mock_set_tx_param_result(esp_lcd_panel_io_handle_t io,
+                                               int lcd_cmd, esp_err_t result);
+
+#ifdef __cplusplus
+}
+#endif
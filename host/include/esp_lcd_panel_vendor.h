@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <esp_lcd_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    int reset_gpio_num;
+    union
+    {
+        esp_lcd_color_space_t color_space;
+        lcd_rgb_element_order_t rgb_ele_order;
+    };
+    uint32_t bits_per_pixel;
+    struct
+    {
+        uint32_t reset_active_high: 1;
+    } flags;
+    void *vendor_config;
+} esp_lcd_panel_dev_config_t;
+
+#ifdef __cplusplus
+}
+#endif
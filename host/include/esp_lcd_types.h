@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+// Subset of the esp_lcd types used by the ILI9488 driver when it is built for
+// the host (linux target), where the esp_lcd component is not available.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+#include <esp_idf_version.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_lcd_panel_io_t esp_lcd_panel_io_t;
+typedef struct esp_lcd_panel_t esp_lcd_panel_t;
+typedef esp_lcd_panel_io_t *esp_lcd_panel_io_handle_t;
+typedef esp_lcd_panel_t *esp_lcd_panel_handle_t;
+
+typedef enum
+{
+    ESP_LCD_COLOR_SPACE_RGB,
+    ESP_LCD_COLOR_SPACE_BGR,
+    ESP_LCD_COLOR_SPACE_MONOCHROME,
+} esp_lcd_color_space_t;
+
+typedef enum
+{
+    LCD_RGB_ELEMENT_ORDER_RGB,
+    LCD_RGB_ELEMENT_ORDER_BGR,
+} lcd_rgb_element_order_t;
+
+#ifdef __cplusplus
+}
+#endif
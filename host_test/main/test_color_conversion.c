@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_lcd_ili9488_color.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// Largest number of pixels converted by a single check, this covers several
+// iterations of the word-at-a-time conversion along with all tail lengths.
+#define MAX_PIXELS 64
+
+// Per-pixel conversion loop used as the reference for all RGB565 to RGB666
+// conversion routines, this matches ili9488_rgb565_to_rgb666_scalar.
+static void reference_rgb565_to_rgb666(uint8_t *buf, const uint16_t *color_data,
+                                       size_t pixels, bool swap_bytes)
+{
+    for (size_t i = 0; i < pixels; i++)
+    {
+        uint16_t color = color_data[i];
+        if (swap_bytes)
+        {
+            color = (color >> 8) | (color << 8);
+        }
+        *buf++ = (uint8_t) (((color & 0xF800) >> 8) | ((color & 0x8000) >> 13));
+        *buf++ = (uint8_t) ((color & 0x07E0) >> 3);
+        *buf++ = (uint8_t) (((color & 0x001F) << 3) | ((color & 0x0010) >> 2));
+    }
+}
+
+// Converts the color data using the routine under test and the reference and
+// checks the results match. The output starts out_offset bytes after a 32-bit
+// aligned address and the byte following the converted pixels must not be
+// modified.
+static void check_rgb565_to_rgb666(const uint16_t *color_data, size_t pixels,
+                                   size_t out_offset, bool swap_bytes)
+{
+    size_t words = (pixels * 3 + out_offset) / 4 + 2;
+    uint32_t *expected_words = (uint32_t *)malloc(words * sizeof(uint32_t));
+    uint32_t *actual_words = (uint32_t *)malloc(words * sizeof(uint32_t));
+    TEST_ASSERT_NOT_NULL(expected_words);
+    TEST_ASSERT_NOT_NULL(actual_words);
+    uint8_t *expected = (uint8_t *)expected_words + out_offset;
+    uint8_t *actual = (uint8_t *)actual_words + out_offset;
+    memset(expected_words, 0xA5, words * sizeof(uint32_t));
+    memset(actual_words, 0xA5, words * sizeof(uint32_t));
+
+    reference_rgb565_to_rgb666(expected, color_data, pixels, swap_bytes);
+    if (swap_bytes)
+    {
+        esp_lcd_ili9488_rgb565_swapped_to_rgb666(actual, color_data, pixels);
+    }
+    else
+    {
+        esp_lcd_ili9488_rgb565_to_rgb666(actual, color_data, pixels);
+    }
+    bool matches = memcmp(expected, actual, pixels * 3 + 1) == 0;
+    free(expected_words);
+    free(actual_words);
+    TEST_ASSERT_TRUE(matches);
+}
+
+void test_rgb565_to_rgb666_matches_scalar(void)
+{
+    uint16_t color_data[MAX_PIXELS];
+    srand(9488);
+    for (size_t idx = 0; idx < MAX_PIXELS; idx++)
+    {
+        color_data[idx] = (uint16_t)rand();
+    }
+
+    for (size_t pixels = 0; pixels <= MAX_PIXELS; pixels++)
+    {
+        check_rgb565_to_rgb666(color_data, pixels, 0, false);
+        check_rgb565_to_rgb666(color_data, pixels, 0, true);
+    }
+}
+
+void test_rgb565_to_rgb666_exhaustive(void)
+{
+    // Every RGB565 value once, starting at a 32-bit aligned address with one
+    // extra pixel so that the values can also be read from an address which
+    // is only 16-bit aligned.
+    const size_t values = 65536;
+    uint32_t *color_words = (uint32_t *)malloc((values + 2) * sizeof(uint16_t));
+    TEST_ASSERT_NOT_NULL(color_words);
+    uint16_t *color_data = (uint16_t *)color_words;
+    color_data[0] = 0xFFFF;
+    for (size_t value = 0; value < values; value++)
+    {
+        color_data[value + 1] = (uint16_t)value;
+    }
+
+    for (size_t in_offset = 0; in_offset < 2; in_offset++)
+    {
+        for (size_t out_offset = 0; out_offset < 4; out_offset++)
+        {
+            // All values in a single call.
+            check_rgb565_to_rgb666(color_data + in_offset, values, out_offset,
+                                   false);
+            check_rgb565_to_rgb666(color_data + in_offset, values, out_offset,
+                                   true);
+
+            // All tail lengths, taken from different parts of the range.
+            for (size_t pixels = 0; pixels <= 16; pixels++)
+            {
+                for (size_t first = 0; first + pixels <= values; first += 8192)
+                {
+                    check_rgb565_to_rgb666(color_data + in_offset + first,
+                                           pixels, out_offset, false);
+                    check_rgb565_to_rgb666(color_data + in_offset + first,
+                                           pixels, out_offset, true);
+                }
+            }
+        }
+    }
+    free(color_words);
+}
@@ -0,0 +1,349 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_lcd_ili9488.h>
+#include <esp_lcd_panel_commands.h>
+#include <esp_lcd_panel_io_mock.h>
+#include <esp_lcd_panel_ops.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <unity.h>
+
+#include "test_panel.h"
+
+typedef struct
+{
+    esp_lcd_panel_io_handle_t io;
+    size_t transfers_in_flight;
+    SemaphoreHandle_t done;
+} submitted_draw_t;
+
+static bool submitted_draw_done(esp_lcd_panel_handle_t panel, void *user_ctx)
+{
+    submitted_draw_t *draw = (submitted_draw_t *)user_ctx;
+    draw->transfers_in_flight =
+        esp_lcd_panel_io_mock_complete_transfers(draw->io);
+    xSemaphoreGive(draw->done);
+    return false;
+}
+
+void test_submitted_draw_callback_waits_for_16bit_transfers(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(16, 64, NULL, &io, &panel);
+
+    // The first frame completes the startup sequence, which waits for the
+    // color data to be sent.
+    const uint16_t color_data[4] = { 0 };
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 2, color_data));
+    TEST_ESP_OK(esp_lcd_ili9488_start_draw_task(panel, NULL));
+
+    // In 16-bit color mode the color data is sent as-is, without draw done
+    // callbacks it must have been sent before the callback is invoked.
+    submitted_draw_t draw =
+    {
+        .io = io,
+        .transfers_in_flight = 1,
+        .done = xSemaphoreCreateBinary(),
+    };
+    TEST_ASSERT_NOT_NULL(draw.done);
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2, color_data,
+                                            submitted_draw_done, &draw));
+    TEST_ASSERT_TRUE(xSemaphoreTake(draw.done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(0, draw.transfers_in_flight);
+
+    vSemaphoreDelete(draw.done);
+    delete_panel(io, panel);
+}
+
+typedef struct
+{
+    esp_lcd_panel_handle_t panel;
+    SemaphoreHandle_t release;
+    SemaphoreHandle_t done;
+} gap_change_t;
+
+static bool hold_draw_task(esp_lcd_panel_handle_t panel, void *user_ctx)
+{
+    gap_change_t *change = (gap_change_t *)user_ctx;
+    xSemaphoreTake(change->release, portMAX_DELAY);
+    return false;
+}
+
+static void set_gap_task(void *arg)
+{
+    gap_change_t *change = (gap_change_t *)arg;
+    TEST_ESP_OK(esp_lcd_panel_set_gap(change->panel, 10, 0));
+    xSemaphoreGive(change->done);
+    vTaskDelete(NULL);
+}
+
+void test_panel_config_is_ordered_with_submitted_draws(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+    TEST_ESP_OK(esp_lcd_ili9488_start_draw_task(panel, NULL));
+
+    gap_change_t change =
+    {
+        .panel = panel,
+        .release = xSemaphoreCreateBinary(),
+        .done = xSemaphoreCreateBinary(),
+    };
+    TEST_ASSERT_NOT_NULL(change.release);
+    TEST_ASSERT_NOT_NULL(change.done);
+
+    // The first draw holds the draw task in its callback while the second
+    // draw and the gap change are queued behind it.
+    const uint16_t color_data[4] = { 0 };
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2, color_data,
+                                            hold_draw_task, &change));
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 4, 0, 6, 2, color_data,
+                                            NULL, NULL));
+    TaskHandle_t task;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(set_gap_task, "set_gap", 4096,
+                                          &change, 5, &task));
+    TEST_ASSERT_FALSE(xSemaphoreTake(change.done, pdMS_TO_TICKS(50)));
+
+    xSemaphoreGive(change.release);
+    TEST_ASSERT_TRUE(xSemaphoreTake(change.done, pdMS_TO_TICKS(1000)));
+
+    // The second draw was executed before the gap changed.
+    size_t length;
+    const uint8_t *bytes = esp_lcd_panel_io_mock_get_bytes(io, &length);
+    size_t count;
+    const esp_lcd_panel_io_mock_transaction_t *transactions =
+        esp_lcd_panel_io_mock_get_transactions(io, &count);
+    size_t columns = 0;
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        if (transactions[idx].lcd_cmd == LCD_CMD_CASET &&
+            transactions[idx].offset + 2 < length &&
+            bytes[transactions[idx].offset + 2] == 4)
+        {
+            columns++;
+        }
+    }
+    TEST_ASSERT_EQUAL(1, columns);
+
+    vSemaphoreDelete(change.release);
+    vSemaphoreDelete(change.done);
+    delete_panel(io, panel);
+}
+
+static bool delete_panel_from_callback(esp_lcd_panel_handle_t panel,
+                                       void *user_ctx)
+{
+    TEST_ESP_OK(esp_lcd_panel_del(panel));
+    xSemaphoreGive((SemaphoreHandle_t)user_ctx);
+    return false;
+}
+
+void test_panel_can_be_deleted_from_draw_task(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+    TEST_ESP_OK(esp_lcd_ili9488_start_draw_task(panel, NULL));
+
+    SemaphoreHandle_t deleted = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(deleted);
+    const uint16_t color_data[4] = { 0 };
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2, color_data,
+                                            delete_panel_from_callback,
+                                            deleted));
+    TEST_ASSERT_TRUE(xSemaphoreTake(deleted, pdMS_TO_TICKS(1000)));
+
+    // Give the draw task time to release the panel and stop.
+    vTaskDelay(pdMS_TO_TICKS(10));
+    vSemaphoreDelete(deleted);
+    TEST_ESP_OK(esp_lcd_panel_io_del(io));
+}
+
+typedef struct
+{
+    esp_lcd_panel_handle_t panel;
+    SemaphoreHandle_t entered;
+    SemaphoreHandle_t release;
+    SemaphoreHandle_t done;
+} queue_full_t;
+
+static bool block_draw_task(esp_lcd_panel_handle_t panel, void *user_ctx)
+{
+    queue_full_t *queue = (queue_full_t *)user_ctx;
+    xSemaphoreGive(queue->entered);
+    xSemaphoreTake(queue->release, portMAX_DELAY);
+    return false;
+}
+
+static void synchronous_draw_task(void *arg)
+{
+    queue_full_t *queue = (queue_full_t *)arg;
+    const uint16_t color_data[4] = { 0 };
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(queue->panel, 0, 0, 2, 2,
+                                          color_data));
+    xSemaphoreGive(queue->done);
+    vTaskDelete(NULL);
+}
+
+void test_draw_task_queue_full(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+    const esp_lcd_ili9488_draw_task_config_t config =
+    {
+        .queue_size = 2,
+        .task_stack_size = 4096,
+        .task_priority = 5,
+        .task_core_id = -1,
+    };
+    TEST_ESP_OK(esp_lcd_ili9488_start_draw_task(panel, &config));
+
+    queue_full_t queue =
+    {
+        .panel = panel,
+        .entered = xSemaphoreCreateBinary(),
+        .release = xSemaphoreCreateBinary(),
+        .done = xSemaphoreCreateBinary(),
+    };
+    TEST_ASSERT_NOT_NULL(queue.entered);
+    TEST_ASSERT_NOT_NULL(queue.release);
+    TEST_ASSERT_NOT_NULL(queue.done);
+
+    // Block the draw task and fill the queue behind it.
+    const uint16_t color_data[4] = { 0 };
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2, color_data,
+                                            block_draw_task, &queue));
+    TEST_ASSERT_TRUE(xSemaphoreTake(queue.entered, pdMS_TO_TICKS(1000)));
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2, color_data,
+                                            NULL, NULL));
+    TEST_ESP_OK(esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2, color_data,
+                                            NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM,
+                      esp_lcd_ili9488_submit_draw(panel, 0, 0, 2, 2,
+                                                  color_data, NULL, NULL));
+
+    // A synchronous draw blocks until the draw task has made room for it.
+    TaskHandle_t task;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(synchronous_draw_task, "sync_draw",
+                                          4096, &queue, 5, &task));
+    TEST_ASSERT_FALSE(xSemaphoreTake(queue.done, pdMS_TO_TICKS(50)));
+    xSemaphoreGive(queue.release);
+    TEST_ASSERT_TRUE(xSemaphoreTake(queue.done, pdMS_TO_TICKS(1000)));
+
+    vSemaphoreDelete(queue.entered);
+    vSemaphoreDelete(queue.release);
+    vSemaphoreDelete(queue.done);
+    delete_panel(io, panel);
+}
+
+enum
+{
+    PRODUCER_COUNT = 4,
+    DRAWS_PER_PRODUCER = 32,
+};
+
+typedef struct
+{
+    esp_lcd_panel_handle_t panel;
+    int producer;
+    int executed[PRODUCER_COUNT * DRAWS_PER_PRODUCER];
+    size_t executed_count;
+    SemaphoreHandle_t done;
+} producers_t;
+
+typedef struct
+{
+    producers_t *producers;
+    int draw;
+} producer_draw_t;
+
+// Records the order in which the draws are executed, this only runs on the
+// draw task.
+static bool record_draw(esp_lcd_panel_handle_t panel, void *user_ctx)
+{
+    producer_draw_t *draw = (producer_draw_t *)user_ctx;
+    producers_t *producers = draw->producers;
+    producers->executed[producers->executed_count++] = draw->draw;
+    return false;
+}
+
+static void producer_task(void *arg)
+{
+    producers_t *producers = (producers_t *)arg;
+    static producer_draw_t draws[PRODUCER_COUNT * DRAWS_PER_PRODUCER];
+    static const uint16_t color_data[4] = { 0 };
+    int producer = __atomic_fetch_add(&producers->producer, 1,
+                                      __ATOMIC_RELAXED);
+    for (int idx = 0; idx < DRAWS_PER_PRODUCER; idx++)
+    {
+        producer_draw_t *draw = &draws[producer * DRAWS_PER_PRODUCER + idx];
+        draw->producers = producers;
+        draw->draw = producer * DRAWS_PER_PRODUCER + idx;
+        esp_err_t ret;
+        while ((ret = esp_lcd_ili9488_submit_draw(
+                    producers->panel, 0, 0, 2, 2, color_data, record_draw,
+                    draw)) == ESP_ERR_NO_MEM)
+        {
+            // The queue is full, a synchronous call waits for room.
+            TEST_ESP_OK(esp_lcd_ili9488_wait_idle(producers->panel, 0));
+        }
+        TEST_ESP_OK(ret);
+    }
+    xSemaphoreGive(producers->done);
+    vTaskDelete(NULL);
+}
+
+void test_draw_task_keeps_order_of_each_producer(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+    const esp_lcd_ili9488_draw_task_config_t config =
+    {
+        .queue_size = 4,
+        .task_stack_size = 4096,
+        .task_priority = 5,
+        .task_core_id = -1,
+    };
+    TEST_ESP_OK(esp_lcd_ili9488_start_draw_task(panel, &config));
+
+    static producers_t producers;
+    producers.panel = panel;
+    producers.producer = 0;
+    producers.executed_count = 0;
+    producers.done = xSemaphoreCreateCounting(PRODUCER_COUNT, 0);
+    TEST_ASSERT_NOT_NULL(producers.done);
+    for (int idx = 0; idx < PRODUCER_COUNT; idx++)
+    {
+        TaskHandle_t task;
+        TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(producer_task, "producer", 4096,
+                                              &producers, 5, &task));
+    }
+    for (int idx = 0; idx < PRODUCER_COUNT; idx++)
+    {
+        TEST_ASSERT_TRUE(xSemaphoreTake(producers.done, pdMS_TO_TICKS(5000)));
+    }
+
+    // A synchronous call is executed after all draws queued before it.
+    TEST_ESP_OK(esp_lcd_ili9488_wait_idle(panel, 0));
+    TEST_ASSERT_EQUAL(PRODUCER_COUNT * DRAWS_PER_PRODUCER,
+                      producers.executed_count);
+    int next[PRODUCER_COUNT] = { 0 };
+    for (size_t idx = 0; idx < producers.executed_count; idx++)
+    {
+        int producer = producers.executed[idx] / DRAWS_PER_PRODUCER;
+        TEST_ASSERT_EQUAL(next[producer]++,
+                          producers.executed[idx] % DRAWS_PER_PRODUCER);
+    }
+
+    vSemaphoreDelete(producers.done);
+    delete_panel(io, panel);
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdlib.h>
+#include <unity.h>
+
+void test_draw_bitmap_sends_window_and_color_data(void);
+void test_unchanged_window_is_not_sent_again(void);
+void test_failed_window_is_sent_again(void);
+void test_failed_color_transfer_stops_draw_bitmap(void);
+void test_color_buffers_are_not_reused_in_flight(void);
+void test_te_sync_skips_small_draws_by_default(void);
+void test_full_screen_fill_repeats_pattern(void);
+void test_failed_transfer_does_not_block_wait_idle(void);
+void test_fill_rect_invokes_draw_done_callback(void);
+void test_register_writes_do_not_complete_startup(void);
+void test_disp_on_completes_startup(void);
+void test_tile_hashes_send_full_width_bands_at_once(void);
+void test_tile_hashes_skip_unchanged_strips(void);
+void test_failed_draw_is_not_skipped_by_shadow_framebuffer(void);
+void test_failed_draw_is_not_skipped_by_tile_hashes(void);
+void test_failed_draw_ends_trace_event(void);
+void test_submitted_draw_callback_waits_for_16bit_transfers(void);
+void test_panel_config_is_ordered_with_submitted_draws(void);
+void test_panel_can_be_deleted_from_draw_task(void);
+void test_draw_task_queue_full(void);
+void test_draw_task_keeps_order_of_each_producer(void);
+void test_rgb565_to_rgb666_matches_scalar(void);
+void test_rgb565_to_rgb666_exhaustive(void);
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_draw_bitmap_sends_window_and_color_data);
+    RUN_TEST(test_unchanged_window_is_not_sent_again);
+    RUN_TEST(test_failed_window_is_sent_again);
+    RUN_TEST(test_failed_color_transfer_stops_draw_bitmap);
+    RUN_TEST(test_color_buffers_are_not_reused_in_flight);
+    RUN_TEST(test_te_sync_skips_small_draws_by_default);
+    RUN_TEST(test_full_screen_fill_repeats_pattern);
+    RUN_TEST(test_failed_transfer_does_not_block_wait_idle);
+    RUN_TEST(test_fill_rect_invokes_draw_done_callback);
+    RUN_TEST(test_register_writes_do_not_complete_startup);
+    RUN_TEST(test_disp_on_completes_startup);
+    RUN_TEST(test_tile_hashes_send_full_width_bands_at_once);
+    RUN_TEST(test_tile_hashes_skip_unchanged_strips);
+    RUN_TEST(test_failed_draw_is_not_skipped_by_shadow_framebuffer);
+    RUN_TEST(test_failed_draw_is_not_skipped_by_tile_hashes);
+    RUN_TEST(test_failed_draw_ends_trace_event);
+    RUN_TEST(test_submitted_draw_callback_waits_for_16bit_transfers);
+    RUN_TEST(test_panel_config_is_ordered_with_submitted_draws);
+    RUN_TEST(test_panel_can_be_deleted_from_draw_task);
+    RUN_TEST(test_draw_task_queue_full);
+    RUN_TEST(test_draw_task_keeps_order_of_each_producer);
+    RUN_TEST(test_rgb565_to_rgb666_matches_scalar);
+    RUN_TEST(test_rgb565_to_rgb666_exhaustive);
+    exit(UNITY_END());
+}
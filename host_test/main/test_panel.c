@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_lcd_panel_io_mock.h>
+#include <esp_lcd_panel_ops.h>
+#include <unity.h>
+
+#include "test_panel.h"
+
+void create_panel(uint32_t bits_per_pixel, size_t buffer_size,
+                  const ili9488_vendor_config_t *vendor_config,
+                  esp_lcd_panel_io_handle_t *io, esp_lcd_panel_handle_t *panel)
+{
+    const esp_lcd_panel_io_mock_config_t io_config =
+    {
+        .buffer_size = 512 * 1024,
+        .max_transactions = 4096,
+    };
+    TEST_ESP_OK(esp_lcd_new_panel_io_mock(&io_config, io));
+    const esp_lcd_panel_dev_config_t panel_config =
+    {
+        .reset_gpio_num = -1,
+        .color_space = ESP_LCD_COLOR_SPACE_BGR,
+        .bits_per_pixel = bits_per_pixel,
+        .vendor_config = (void *)vendor_config,
+    };
+    TEST_ESP_OK(esp_lcd_new_panel_ili9488(*io, &panel_config, buffer_size,
+                                          panel));
+    TEST_ESP_OK(esp_lcd_panel_reset(*panel));
+    TEST_ESP_OK(esp_lcd_panel_init(*panel));
+    esp_lcd_panel_io_mock_clear(*io);
+}
+
+void delete_panel(esp_lcd_panel_io_handle_t io, esp_lcd_panel_handle_t panel)
+{
+    TEST_ESP_OK(esp_lcd_panel_del(panel));
+    TEST_ESP_OK(esp_lcd_panel_io_del(io));
+}
+
+void expect_bytes(esp_lcd_panel_io_handle_t io, const uint8_t *expected,
+                  size_t length)
+{
+    size_t recorded;
+    const uint8_t *bytes = esp_lcd_panel_io_mock_get_bytes(io, &recorded);
+    TEST_ASSERT_EQUAL(length, recorded);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, bytes, length);
+}
+
+bool transactions_contain(esp_lcd_panel_io_handle_t io, int lcd_cmd)
+{
+    size_t count;
+    const esp_lcd_panel_io_mock_transaction_t *transactions =
+        esp_lcd_panel_io_mock_get_transactions(io, &count);
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        if (transactions[idx].lcd_cmd == lcd_cmd)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t count_color_transfers(esp_lcd_panel_io_handle_t io, size_t *color_bytes)
+{
+    size_t count;
+    const esp_lcd_panel_io_mock_transaction_t *transactions =
+        esp_lcd_panel_io_mock_get_transactions(io, &count);
+    size_t color_transfers = 0;
+    *color_bytes = 0;
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        if (transactions[idx].color)
+        {
+            color_transfers++;
+            *color_bytes += transactions[idx].length;
+        }
+    }
+    return color_transfers;
+}
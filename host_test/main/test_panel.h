@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <esp_lcd_ili9488.h>
+#include <esp_lcd_panel_io.h>
+
+// Creates a panel connected to a mock panel IO which has been reset and
+// initialized, the commands sent by the initialization are discarded.
+void create_panel(uint32_t bits_per_pixel, size_t buffer_size,
+                  const ili9488_vendor_config_t *vendor_config,
+                  esp_lcd_panel_io_handle_t *io, esp_lcd_panel_handle_t *panel);
+
+void delete_panel(esp_lcd_panel_io_handle_t io, esp_lcd_panel_handle_t panel);
+
+// Checks that the mock panel IO recorded exactly the expected bytes.
+void expect_bytes(esp_lcd_panel_io_handle_t io, const uint8_t *expected,
+                  size_t length);
+
+// Returns true when the mock panel IO recorded the given command.
+bool transactions_contain(esp_lcd_panel_io_handle_t io, int lcd_cmd);
+
+// Returns the number of color transfers recorded by the mock panel IO, the
+// number of color data bytes is returned via color_bytes.
+size_t count_color_transfers(esp_lcd_panel_io_handle_t io, size_t *color_bytes);
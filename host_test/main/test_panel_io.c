@@ -0,0 +1,499 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <esp_lcd_ili9488.h>
+#include <esp_lcd_panel_commands.h>
+#include <esp_lcd_panel_io_mock.h>
+#include <esp_lcd_panel_ops.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "test_panel.h"
+
+void test_draw_bitmap_sends_window_and_color_data(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    // Red, green, blue and white.
+    const uint16_t color_data[] = { 0xF800, 0x07E0, 0x001F, 0xFFFF };
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 1, 2, 3, 4, color_data));
+
+    // The first frame completes the startup sequence deferred by init.
+    const uint8_t expected[] =
+    {
+        LCD_CMD_CASET, 0x00, 0x01, 0x00, 0x02,
+        LCD_CMD_RASET, 0x00, 0x02, 0x00, 0x03,
+        LCD_CMD_RAMWR,
+            0xFC, 0x00, 0x00, 0x00, 0xFC, 0x00,
+            0x00, 0x00, 0xFC, 0xFC, 0xFC, 0xFC,
+        LCD_CMD_SLPOUT,
+        LCD_CMD_IDMOFF,
+        LCD_CMD_DISPON,
+    };
+    expect_bytes(io, expected, sizeof(expected));
+
+    delete_panel(io, panel);
+}
+
+void test_unchanged_window_is_not_sent_again(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    const uint16_t color_data[] = { 0x0000, 0xFFFF };
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 1, color_data));
+    esp_lcd_panel_io_mock_clear(io);
+
+    // The commands completing the startup sequence have waited for the first
+    // transfer. With a single conversion buffer the NOP waits for the
+    // previous transfer before the buffer is reused. Only the changed row
+    // range is sent.
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 1, color_data));
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 1, color_data));
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 5, 2, 6, color_data));
+    const uint8_t expected[] =
+    {
+        LCD_CMD_RAMWR, 0x00, 0x00, 0x00, 0xFC, 0xFC, 0xFC,
+        LCD_CMD_NOP,
+        LCD_CMD_RAMWR, 0x00, 0x00, 0x00, 0xFC, 0xFC, 0xFC,
+        LCD_CMD_RASET, 0x00, 0x05, 0x00, 0x05,
+        LCD_CMD_RAMWR, 0x00, 0x00, 0x00, 0xFC, 0xFC, 0xFC,
+    };
+    expect_bytes(io, expected, sizeof(expected));
+
+    delete_panel(io, panel);
+}
+
+void test_failed_window_is_sent_again(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    const uint16_t color_data[] = { 0x0000, 0xFFFF };
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 1, color_data));
+
+    // CASET is sent but RASET fails, the error is returned and the address
+    // window of the display is no longer known.
+    esp_lcd_panel_io_mock_set_tx_param_result(io, LCD_CMD_RASET, ESP_FAIL);
+    TEST_ASSERT_EQUAL(ESP_FAIL, esp_lcd_panel_draw_bitmap(panel, 4, 4, 6, 5,
+                                                          color_data));
+    esp_lcd_panel_io_mock_set_tx_param_result(io, LCD_CMD_RASET, ESP_OK);
+    esp_lcd_panel_io_mock_clear(io);
+
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 4, 4, 6, 5, color_data));
+    const uint8_t expected[] =
+    {
+        LCD_CMD_CASET, 0x00, 0x04, 0x00, 0x05,
+        LCD_CMD_RASET, 0x00, 0x04, 0x00, 0x04,
+        LCD_CMD_RAMWR, 0x00, 0x00, 0x00, 0xFC, 0xFC, 0xFC,
+    };
+    expect_bytes(io, expected, sizeof(expected));
+
+    delete_panel(io, panel);
+}
+
+void test_failed_color_transfer_stops_draw_bitmap(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    // The area is sent in four slices of the conversion buffer, the draw
+    // stops at the first slice the panel IO refuses and returns its error.
+    uint16_t color_data[16 * 16] = { 0 };
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_ERR_INVALID_STATE);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE,
+                      esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16,
+                                                color_data));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_OK);
+    TEST_ASSERT_FALSE(transactions_contain(io, LCD_CMD_NOP));
+    TEST_ASSERT_FALSE(transactions_contain(io, LCD_CMD_WRMEMC));
+
+    delete_panel(io, panel);
+}
+
+void test_color_buffers_are_not_reused_in_flight(void)
+{
+    const ili9488_vendor_config_t vendor_config =
+    {
+        .color_buffer_count = 2,
+    };
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, &vendor_config, &io, &panel);
+
+    // The area is sent in four slices, the mock does not complete a transfer
+    // until the next command is sent. A conversion buffer is only refilled
+    // once its previous transfer has completed.
+    uint16_t color_data[16 * 16];
+    for (size_t idx = 0; idx < 16 * 16; idx++)
+    {
+        color_data[idx] = idx * 31;
+    }
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+    esp_lcd_panel_io_mock_complete_transfers(io);
+    TEST_ASSERT_EQUAL(0, esp_lcd_panel_io_mock_get_modified_transfers(io));
+
+    delete_panel(io, panel);
+}
+
+void test_te_sync_skips_small_draws_by_default(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    const ili9488_vendor_config_t vendor_config =
+    {
+        .te_gpio_num = 4,
+        .flags =
+        {
+            .enable_te_sync = 1,
+        },
+    };
+    create_panel(18, 1024, &vendor_config, &io, &panel);
+
+    // The host has no TE signal, synchronized draws wait for the timeout.
+    // The first draw completes the startup sequence and is not synchronized.
+    const size_t large_pixels = 320 * 120;
+    uint16_t *color_data = (uint16_t *)calloc(large_pixels, sizeof(uint16_t));
+    TEST_ASSERT_NOT_NULL(color_data);
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 8, 8, color_data));
+
+    int64_t start_us = esp_timer_get_time();
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 8, 8, color_data));
+    TEST_ASSERT_LESS_OR_EQUAL(20000, esp_timer_get_time() - start_us);
+
+    start_us = esp_timer_get_time();
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 320, 120, color_data));
+    TEST_ASSERT_GREATER_OR_EQUAL(30000, esp_timer_get_time() - start_us);
+
+    free(color_data);
+    delete_panel(io, panel);
+}
+
+void test_full_screen_fill_repeats_pattern(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    TEST_ESP_OK(esp_lcd_ili9488_fill_rect(panel, 0, 0, 320, 480, 0x001F));
+
+    size_t count;
+    const esp_lcd_panel_io_mock_transaction_t *transactions =
+        esp_lcd_panel_io_mock_get_transactions(io, &count);
+    size_t color_transfers = 0;
+    size_t color_bytes = 0;
+    for (size_t idx = 0; idx < count; idx++)
+    {
+        if (transactions[idx].color)
+        {
+            TEST_ASSERT_EQUAL(color_transfers ? LCD_CMD_WRMEMC : LCD_CMD_RAMWR,
+                              transactions[idx].lcd_cmd);
+            color_transfers++;
+            color_bytes += transactions[idx].length;
+        }
+    }
+    // The pattern buffer holds a single row.
+    TEST_ASSERT_EQUAL(480, color_transfers);
+    TEST_ASSERT_EQUAL(320 * 480 * 3, color_bytes);
+
+    delete_panel(io, panel);
+}
+
+static bool count_draw_done(esp_lcd_panel_handle_t panel, void *user_ctx)
+{
+    (*(int *)user_ctx)++;
+    return false;
+}
+
+void test_failed_transfer_does_not_block_wait_idle(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(16, 64, NULL, &io, &panel);
+
+    int draws_done = 0;
+    TEST_ESP_OK(esp_lcd_ili9488_register_draw_done_callback(
+        panel, count_draw_done, &draws_done));
+
+    // A transfer which the panel IO refuses never completes, it must not be
+    // counted as in flight.
+    const uint16_t color_data[4] = { 0 };
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_ERR_NO_MEM);
+    esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 2, color_data);
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_OK);
+    TEST_ESP_OK(esp_lcd_ili9488_wait_idle(panel, 100));
+
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 2, color_data));
+    esp_lcd_panel_io_mock_complete_transfers(io);
+    TEST_ESP_OK(esp_lcd_ili9488_wait_idle(panel, 100));
+    TEST_ASSERT_GREATER_OR_EQUAL(1, draws_done);
+
+    delete_panel(io, panel);
+}
+
+void test_fill_rect_invokes_draw_done_callback(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    int draws_done = 0;
+    TEST_ESP_OK(esp_lcd_ili9488_register_draw_done_callback(
+        panel, count_draw_done, &draws_done));
+
+    // The callback is invoked once the last pattern transfer has completed.
+    TEST_ESP_OK(esp_lcd_ili9488_fill_rect(panel, 0, 0, 320, 2, 0x001F));
+    esp_lcd_panel_io_mock_complete_transfers(io);
+    TEST_ESP_OK(esp_lcd_ili9488_wait_idle(panel, 100));
+    TEST_ASSERT_EQUAL(1, draws_done);
+
+    delete_panel(io, panel);
+}
+
+void test_register_writes_do_not_complete_startup(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    // Register writes are valid in sleep mode and are sent right away.
+    TEST_ESP_OK(esp_lcd_panel_invert_color(panel, true));
+    TEST_ESP_OK(esp_lcd_panel_swap_xy(panel, false));
+    TEST_ESP_OK(esp_lcd_panel_mirror(panel, true, false));
+    TEST_ASSERT_TRUE(transactions_contain(io, LCD_CMD_INVON));
+    TEST_ASSERT_TRUE(transactions_contain(io, LCD_CMD_MADCTL));
+    TEST_ASSERT_FALSE(transactions_contain(io, LCD_CMD_SLPOUT));
+
+    // The first frame completes the startup sequence.
+    const uint16_t color_data[4] = { 0 };
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 2, 2, color_data));
+    TEST_ASSERT_TRUE(transactions_contain(io, LCD_CMD_SLPOUT));
+
+    delete_panel(io, panel);
+}
+
+void test_disp_on_completes_startup(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+
+    // Turning the display off only records the state.
+    TEST_ESP_OK(esp_lcd_panel_disp_on_off(panel, false));
+    TEST_ASSERT_FALSE(transactions_contain(io, LCD_CMD_SLPOUT));
+    TEST_ASSERT_FALSE(transactions_contain(io, LCD_CMD_DISPOFF));
+
+    // Turning it on completes the startup sequence without a draw.
+    TEST_ESP_OK(esp_lcd_panel_disp_on_off(panel, true));
+    TEST_ASSERT_TRUE(transactions_contain(io, LCD_CMD_SLPOUT));
+    TEST_ASSERT_TRUE(transactions_contain(io, LCD_CMD_DISPON));
+
+    delete_panel(io, panel);
+}
+
+void test_tile_hashes_send_full_width_bands_at_once(void)
+{
+    const ili9488_vendor_config_t vendor_config =
+    {
+        .flags =
+        {
+            .enable_tile_hashes = 1,
+        },
+    };
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(16, 64, &vendor_config, &io, &panel);
+
+    uint16_t *color_data = calloc(320 * 32, sizeof(uint16_t));
+    TEST_ASSERT_NOT_NULL(color_data);
+
+    // All tiles have changed, each band of 16 rows is sent as one transfer.
+    size_t color_bytes;
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 320, 32, color_data));
+    TEST_ASSERT_EQUAL(2, count_color_transfers(io, &color_bytes));
+    TEST_ASSERT_EQUAL(320 * 32 * 2, color_bytes);
+
+    // A single changed tile is sent one row at a time.
+    esp_lcd_panel_io_mock_clear(io);
+    color_data[320 * 20 + 40] = 0xFFFF;
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 320, 32, color_data));
+    TEST_ASSERT_EQUAL(16, count_color_transfers(io, &color_bytes));
+    TEST_ASSERT_EQUAL(16 * 16 * 2, color_bytes);
+
+    free(color_data);
+    delete_panel(io, panel);
+}
+
+void test_tile_hashes_skip_unchanged_strips(void)
+{
+    const ili9488_vendor_config_t vendor_config =
+    {
+        .flags =
+        {
+            .enable_tile_hashes = 1,
+        },
+    };
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(16, 64, &vendor_config, &io, &panel);
+
+    // Strips of 25 lines as drawn by LVGL, most of them only cover part of
+    // the rows of the first and last row of tiles.
+    uint16_t *color_data = calloc(320 * 100, sizeof(uint16_t));
+    TEST_ASSERT_NOT_NULL(color_data);
+    for (size_t idx = 0; idx < 320 * 100; idx++)
+    {
+        color_data[idx] = idx * 7;
+    }
+    for (int frame = 0; frame < 2; frame++)
+    {
+        esp_lcd_panel_io_mock_clear(io);
+        for (int y = 0; y < 100; y += 25)
+        {
+            TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, y, 320, y + 25,
+                                                  color_data + y * 320));
+        }
+    }
+    size_t color_bytes;
+    TEST_ASSERT_EQUAL(0, count_color_transfers(io, &color_bytes));
+
+    // A change to the rows of a tile drawn by the second strip only sends
+    // those rows of the tile.
+    esp_lcd_panel_io_mock_clear(io);
+    color_data[320 * 30 + 40] ^= 0xFFFF;
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 25, 320, 50,
+                                          color_data + 25 * 320));
+    count_color_transfers(io, &color_bytes);
+    TEST_ASSERT_EQUAL(16 * 7 * 2, color_bytes);
+
+    free(color_data);
+    delete_panel(io, panel);
+}
+
+void test_failed_draw_is_not_skipped_by_shadow_framebuffer(void)
+{
+    const ili9488_vendor_config_t vendor_config =
+    {
+        .flags =
+        {
+            .enable_shadow_framebuffer = 1,
+        },
+    };
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 256, &vendor_config, &io, &panel);
+
+    uint16_t color_data[16 * 16] = { 0 };
+    size_t color_bytes;
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+
+    // The display may have received none of a failed draw, drawing the same
+    // color data again must send it.
+    memset(color_data, 0xFF, sizeof(color_data));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_FAIL);
+    TEST_ASSERT_EQUAL(ESP_FAIL, esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16,
+                                                          color_data));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_OK);
+    esp_lcd_panel_io_mock_clear(io);
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+    count_color_transfers(io, &color_bytes);
+    TEST_ASSERT_EQUAL(16 * 16 * 3, color_bytes);
+
+    // The same applies to a failed fill.
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_FAIL);
+    TEST_ASSERT_EQUAL(ESP_FAIL, esp_lcd_ili9488_fill_rect(panel, 0, 0, 16, 16,
+                                                          0x0000));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_OK);
+    memset(color_data, 0, sizeof(color_data));
+    esp_lcd_panel_io_mock_clear(io);
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+    count_color_transfers(io, &color_bytes);
+    TEST_ASSERT_EQUAL(16 * 16 * 3, color_bytes);
+
+    delete_panel(io, panel);
+}
+
+void test_failed_draw_is_not_skipped_by_tile_hashes(void)
+{
+    const ili9488_vendor_config_t vendor_config =
+    {
+        .flags =
+        {
+            .enable_tile_hashes = 1,
+        },
+    };
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(16, 64, &vendor_config, &io, &panel);
+
+    uint16_t color_data[16 * 16] = { 0 };
+    size_t color_bytes;
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+
+    memset(color_data, 0xFF, sizeof(color_data));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_FAIL);
+    TEST_ASSERT_EQUAL(ESP_FAIL, esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16,
+                                                          color_data));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_OK);
+    esp_lcd_panel_io_mock_clear(io);
+    TEST_ESP_OK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 16, 16, color_data));
+    count_color_transfers(io, &color_bytes);
+    TEST_ASSERT_EQUAL(16 * 16 * 2, color_bytes);
+
+    delete_panel(io, panel);
+}
+
+void test_failed_draw_ends_trace_event(void)
+{
+    esp_lcd_panel_io_handle_t io;
+    esp_lcd_panel_handle_t panel;
+    create_panel(18, 64, NULL, &io, &panel);
+    TEST_ESP_OK(esp_lcd_ili9488_clear_trace());
+
+    const uint8_t color_data[2 * 2 * 3] = { 0 };
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_ERR_NO_MEM);
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_lcd_ili9488_draw_bitmap_rgb666(
+        panel, 0, 0, 2, 2, color_data));
+    esp_lcd_panel_io_mock_set_tx_color_result(io, ESP_OK);
+
+    // Every draw begin event is matched by an end event.
+    char *trace = NULL;
+    size_t trace_size = 0;
+    FILE *stream = open_memstream(&trace, &trace_size);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ESP_OK(esp_lcd_ili9488_dump_trace(stream));
+    fclose(stream);
+    int begin = 0;
+    int end = 0;
+    for (char *line = strtok(trace, "\n"); line; line = strtok(NULL, "\n"))
+    {
+        char phase;
+        char event[32];
+        if (sscanf(line, "ili9488-trace %*u %*u %c %31s", &phase, event) == 2 &&
+            strcmp(event, "draw") == 0)
+        {
+            begin += phase == 'B';
+            end += phase == 'E';
+        }
+    }
+    free(trace);
+    TEST_ASSERT_EQUAL(1, begin);
+    TEST_ASSERT_EQUAL(begin, end);
+
+    delete_panel(io, panel);
+}
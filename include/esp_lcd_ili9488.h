@@ -6,12 +6,183 @@
 
 #pragma once
 
+#include <stdio.h>
+
 #include "esp_lcd_panel_vendor.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief ILI9488 vendor specific configuration.
+ *
+ * This structure is optional and can be provided via the vendor_config field
+ * of esp_lcd_panel_dev_config_t, leave vendor_config as NULL to use the
+ * default settings.
+ */
+typedef struct
+{
+    /**
+     * Number of color conversion buffers to use in 18-bit color mode. Each
+     * buffer holds buffer_size pixels and they are used in rotation so that
+     * the next draw can be converted while the previous one is still being
+     * transmitted. Valid values are 1 (default, also used for 0) to 4.
+     *
+     * NOTE: The SPI panel IO waits for the previous transfers before each
+     * transfer is started, the i80 panel IO does not. Once all buffers have
+     * been queued without a command in between the driver sends a NOP to
+     * wait for them before a buffer is refilled, with the i80 panel IO at
+     * most color_buffer_count - 1 transfers overlap with the conversion.
+     */
+    size_t color_buffer_count;
+
+    /**
+     * GPIO connected to the TE (tearing effect) output of the ILI9488, only
+     * used when flags.enable_te_sync is set.
+     */
+    int te_gpio_num;
+
+    /**
+     * Minimum number of pixels a draw must cover before it waits for the
+     * vertical blanking period signalled via the TE output, zero uses a
+     * quarter of the screen (38400 pixels). Only used when
+     * flags.enable_te_sync is set.
+     */
+    size_t te_sync_min_pixels;
+
+    /**
+     * Clock frequency of the panel IO in Hz, used to estimate how long a
+     * draw takes to transmit. Required when flags.enable_scanline_sync is
+     * set.
+     */
+    uint32_t scanline_sync_pclk_hz;
+
+    /**
+     * Minimum number of pixels a draw must cover before it is paced based on
+     * the scanline, zero will cause all draws to be paced. Only used when
+     * flags.enable_scanline_sync is set.
+     */
+    size_t scanline_sync_min_pixels;
+
+    struct
+    {
+        /**
+         * Set to enable the TE output of the ILI9488 and to start large
+         * draws at the beginning of the vertical blanking period to avoid
+         * tearing. Requires te_gpio_num to be set.
+         */
+        unsigned int enable_te_sync: 1;
+
+        /**
+         * Set to read the current scanline (Get_Scanline) before draws and
+         * delay them until the display scan has left the area being updated
+         * to avoid tearing when the TE output is not connected. Requires the
+         * SDO (MISO) pin of the ILI9488 to be connected and the panel IO to
+         * support reading (SPI only), ignored when enable_te_sync is set.
+         * Draws covering more lines than can be sent within a single frame
+         * are not paced.
+         */
+        unsigned int enable_scanline_sync: 1;
+
+        /**
+         * Set when the RGB565 color data passed to draw_bitmap has the two
+         * bytes of each pixel swapped (big-endian), such as when LVGL is
+         * configured with CONFIG_LV_COLOR_16_SWAP. The swap is done as part
+         * of the 18-bit color conversion. For 16-bit color mode use the
+         * swap_color_bytes flag of the panel IO instead.
+         */
+        unsigned int swap_color_bytes: 1;
+
+        /**
+         * Set to keep a copy of the frame memory (320x480 RGB666, 450kB) in
+         * PSRAM. Draws are compared to it in tiles of 16x16 pixels and only
+         * the tiles which have changed are sent to the display. Requires
+         * 18-bit color mode and PSRAM.
+         */
+        unsigned int enable_shadow_framebuffer: 1;
+
+        /**
+         * Set to keep 32-bit hashes of the color data drawn to each tile of
+         * 16x16 pixels (7.2kB in total). Tiles covered by the width of a draw
+         * whose hash is unchanged are neither converted nor sent to the
+         * display, the rows of a tile above and below the end of a draw are
+         * hashed separately.
+         * Not supported in 3-bit color mode, ignored when
+         * enable_shadow_framebuffer is set.
+         */
+        unsigned int enable_tile_hashes: 1;
+    } flags;
+} ili9488_vendor_config_t;
+
+/**
+ * @brief ILI9488 bus statistics and performance counters.
+ *
+ * Every command sent to the display counts as one command, the command
+ * parameters and color data are counted separately. The number of bytes
+ * used for the command itself depends on the lcd_cmd_bits of the panel IO.
+ *
+ * All times are measured using esp_timer. The counters are only maintained
+ * when CONFIG_ILI9488_ENABLE_STATS is enabled.
+ */
+typedef struct
+{
+    uint32_t commands;          /*!< Commands sent, including those preceding color data */
+    uint32_t parameter_bytes;   /*!< Command parameter bytes sent */
+    uint32_t color_transfers;   /*!< Color data transfers queued */
+    uint64_t color_bytes;       /*!< Color data bytes queued */
+    uint32_t address_commands_skipped; /*!< CASET/RASET commands not sent as the address window was unchanged */
+    uint64_t unchanged_pixels_skipped; /*!< Pixels not sent as they were unchanged */
+    uint32_t draws;             /*!< Draws, each area of esp_lcd_ili9488_draw_bitmaps counts as one */
+    uint64_t pixels_converted;  /*!< Pixels converted to the display color format */
+    uint64_t conversion_time_us; /*!< Time spent converting color data */
+    uint64_t queue_wait_time_us; /*!< Time spent waiting for the panel IO to accept commands and color data */
+    uint32_t max_draw_latency_us; /*!< Longest time taken by a single draw call to queue all of its color data */
+    uint32_t max_buffer_pixels; /*!< Highest number of pixels converted into a color conversion buffer at once */
+} esp_lcd_ili9488_stats_t;
+
+/**
+ * @brief Callback invoked when all color data of a draw has been sent to the
+ * display and the color data buffer can be reused.
+ *
+ * @param[in] panel LCD panel handle which completed the draw
+ * @param[in] user_ctx User context provided when registering the callback or
+ * submitting the draw
+ * @return Whether a high priority task has been woken up by this function
+ *
+ * NOTE: This is usually called from the ISR of the panel IO and must follow
+ * the same rules as the on_color_trans_done callback of the panel IO. When
+ * the draw has already completed by the time it has been queued, it is
+ * called from the task which submitted the draw or from the draw task when
+ * esp_lcd_ili9488_start_draw_task is used.
+ */
+typedef bool (*esp_lcd_ili9488_draw_done_cb_t)(esp_lcd_panel_handle_t panel,
+                                               void *user_ctx);
+
+/**
+ * @brief Rectangular area and color data for esp_lcd_ili9488_draw_bitmaps.
+ */
+typedef struct
+{
+    int x_start;            /*!< Start index on x-axis (x_start included) */
+    int y_start;            /*!< Start index on y-axis (y_start included) */
+    int x_end;              /*!< End index on x-axis (x_end not included) */
+    int y_end;              /*!< End index on y-axis (y_end not included) */
+    const void *color_data; /*!< Color data for the area, same format as draw_bitmap */
+} esp_lcd_ili9488_rect_t;
+
+/**
+ * @brief Configuration of the draw task started by
+ * esp_lcd_ili9488_start_draw_task.
+ */
+typedef struct
+{
+    uint32_t queue_size;      /*!< Number of draws which can be queued, must be a power of two */
+    uint32_t task_stack_size; /*!< Stack size of the draw task in bytes */
+    uint32_t task_priority;   /*!< Priority of the draw task */
+    int task_core_id;         /*!< Core the draw task is pinned to, -1 for no affinity */
+} esp_lcd_ili9488_draw_task_config_t;
+
 /**
  * @brief Create LCD panel for model ILI9488
  *
@@ -27,9 +198,25 @@ extern "C" {
  * NOTE: If you are using the SPI interface you *MUST* 18-bit color mode
  * in @param panel_dev_config field bits_per_pixel and @param buffer_size
  * must be provided.
+ *
+ * NOTE: @param buffer_size is the number of pixels which can be converted at
+ * once, it does not need to cover the largest area being drawn. Larger areas
+ * will be converted and transmitted in multiple slices.
  * 
  * NOTE: For parallel IO (Intel 8080) interface 16-bit color mode should
  * be used and @param buffer_size will be ignored.
+ *
+ * NOTE: The format of the color data passed to draw_bitmap is selected via
+ * the @param panel_dev_config field bits_per_pixel:
+ *   - 16: RGB565, sent as-is using 16-bit color mode.
+ *   - 18: RGB565, converted to RGB666 using 18-bit color mode.
+ *   - 24: RGB888 stored as blue, green, red bytes (little-endian 0xRRGGBB),
+ *         converted to RGB666 using 18-bit color mode.
+ *   - 32: XRGB8888 (native-endian 0xXXRRGGBB, upper byte ignored), converted
+ *         to RGB666 using 18-bit color mode.
+ *   - 3:  RGB565, converted to 3-bit color mode (8 colors) which packs two
+ *         pixels per byte. Only the most significant bit of each color
+ *         component is used. @param buffer_size must be at least 2.
  */
 esp_err_t esp_lcd_new_panel_ili9488(const esp_lcd_panel_io_handle_t io,
                                     const esp_lcd_panel_dev_config_t *panel_dev_config,
@@ -53,6 +240,368 @@ esp_err_t esp_lcd_new_panel_ili9488_ips(const esp_lcd_panel_io_handle_t io,
                                         const size_t buffer_size,
                                         esp_lcd_panel_handle_t *ret_panel);
 
+/**
+ * @brief Draw RGB666 color data which is already in the format used by the
+ * ILI9488 in 18-bit color mode.
+ *
+ * The color data is transmitted as-is, without conversion and without using
+ * the color conversion buffers. Each pixel is three bytes (red, green, blue)
+ * with the color in the upper six bits of each byte.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] x_start Start index on x-axis (x_start included)
+ * @param[in] y_start Start index on y-axis (y_start included)
+ * @param[in] x_end End index on x-axis (x_end not included)
+ * @param[in] y_end End index on y-axis (y_end not included)
+ * @param[in] color_data RGB666 color data, this must be DMA capable memory
+ * and must remain valid until the transfer has completed.
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if the panel is not using 18-bit color mode
+ *          - ESP_OK                on success
+ *
+ * NOTE: When this is the only drawing API being used the panel can be created
+ * with a buffer_size of zero to skip allocating color conversion buffers.
+ */
+esp_err_t esp_lcd_ili9488_draw_bitmap_rgb666(esp_lcd_panel_handle_t panel,
+                                             int x_start, int y_start,
+                                             int x_end, int y_end,
+                                             const void *color_data);
+
+/**
+ * @brief Draw multiple areas of color data in a single call.
+ *
+ * Rectangles which use the same columns and are vertically adjacent or
+ * overlapping are sent as a single memory write, using the same address
+ * window. When none of the rectangles overlap they are reordered so that
+ * rectangles sharing the same columns are drawn together, otherwise they are
+ * drawn in the order provided with later rectangles overwriting earlier ones.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] rects Areas to draw along with their color data
+ * @param[in] count Number of entries in @param rects
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if no color conversion buffer is available
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_draw_bitmaps(esp_lcd_panel_handle_t panel,
+                                       const esp_lcd_ili9488_rect_t *rects,
+                                       size_t count);
+
+/**
+ * @brief Fill an area of the display with a single color.
+ *
+ * No color data buffer is required, the color is converted once into a DMA
+ * capable pattern buffer of 320 pixels (960 bytes in 18-bit color mode) which
+ * is allocated on first use and sent repeatedly until the area has been
+ * filled.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] x_start Start index on x-axis (x_start included)
+ * @param[in] y_start Start index on y-axis (y_start included)
+ * @param[in] x_end End index on x-axis (x_end not included)
+ * @param[in] y_end End index on y-axis (y_end not included)
+ * @param[in] color Color to fill the area with, in the same format as a
+ * single pixel of the color data passed to draw_bitmap (as an example a
+ * RGB565 value when bits_per_pixel is 3, 16 or 18, 0xRRGGBB when it is 24).
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NO_MEM        if the pattern buffer could not be allocated
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_fill_rect(esp_lcd_panel_handle_t panel,
+                                    int x_start, int y_start,
+                                    int x_end, int y_end, uint32_t color);
+
+/**
+ * @brief Define the vertical scrolling area of the display.
+ *
+ * The display is divided into a fixed area at the top, a scrolling area and a
+ * fixed area at the bottom, which together must cover all 480 lines of the
+ * panel. The lines are counted along the 480 pixel side of the panel in the
+ * order they are scanned and are not affected by mirror or swap_xy.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] top_fixed_lines Number of lines in the top fixed area
+ * @param[in] scroll_lines Number of lines in the scrolling area
+ * @param[in] bottom_fixed_lines Number of lines in the bottom fixed area
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_set_scroll_area(esp_lcd_panel_handle_t panel,
+                                          uint16_t top_fixed_lines,
+                                          uint16_t scroll_lines,
+                                          uint16_t bottom_fixed_lines);
+
+/**
+ * @brief Set the frame memory line shown at the top of the scrolling area.
+ *
+ * Advancing the start line by one scrolls the content of the scrolling area
+ * by one line, only the line which becomes visible at the end of the
+ * scrolling area needs to be redrawn afterwards.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] start_line Frame memory line shown at the top of the scrolling
+ * area, must be within the scrolling area defined via
+ * esp_lcd_ili9488_set_scroll_area.
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if no scrolling area has been defined
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_scroll(esp_lcd_panel_handle_t panel,
+                                 uint16_t start_line);
+
+/**
+ * @brief Define the area of the display which is shown in partial mode.
+ *
+ * The lines are counted along the 480 pixel side of the panel in the order
+ * they are scanned and are not affected by mirror or swap_xy. When partial
+ * mode is already enabled the new area is shown immediately.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] start_line First line of the partial area (included)
+ * @param[in] end_line Last line of the partial area (not included)
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_set_partial_area(esp_lcd_panel_handle_t panel,
+                                           uint16_t start_line,
+                                           uint16_t end_line);
+
+/**
+ * @brief Enable or disable partial display mode.
+ *
+ * In partial mode the display only shows the lines of the partial area
+ * defined via esp_lcd_ili9488_set_partial_area, all other lines are shown as
+ * black. The frame memory is not modified and the full content is shown again
+ * when partial mode is disabled.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] enable True to enter partial mode, false for normal mode
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if no partial area has been defined
+ *          - ESP_OK                on success
+ *
+ * NOTE: A panel reset returns the display to normal mode.
+ */
+esp_err_t esp_lcd_ili9488_partial_mode(esp_lcd_panel_handle_t panel,
+                                       bool enable);
+
+/**
+ * @brief Enable draw done callbacks and register the default callback.
+ *
+ * The default callback is invoked once all color data of a draw_bitmap,
+ * esp_lcd_ili9488_draw_bitmaps, esp_lcd_ili9488_draw_bitmap_rgb666 or
+ * esp_lcd_ili9488_fill_rect call has been sent. It may be NULL when only esp_lcd_ili9488_draw_bitmap_with_cb
+ * and esp_lcd_ili9488_wait_idle are used.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] callback Default draw done callback, may be NULL
+ * @param[in] user_ctx User context passed to @param callback
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NO_MEM        if out of memory
+ *          - ESP_ERR_NOT_SUPPORTED if ESP-IDF is older than v5.0
+ *          - ESP_OK                on success
+ *
+ * NOTE: This replaces the on_color_trans_done callback of the panel IO and
+ * logs a warning, a callback provided in the panel IO configuration is no
+ * longer invoked. The draw done callback should be used instead, as an
+ * example to notify LVGL that the flush has completed.
+ */
+esp_err_t esp_lcd_ili9488_register_draw_done_callback(
+    esp_lcd_panel_handle_t panel, esp_lcd_ili9488_draw_done_cb_t callback,
+    void *user_ctx);
+
+/**
+ * @brief Draw color data and invoke a callback specific to this draw once
+ * all color data has been sent.
+ *
+ * This behaves as draw_bitmap except that @param callback is invoked instead
+ * of the default draw done callback.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] x_start Start index on x-axis (x_start included)
+ * @param[in] y_start Start index on y-axis (y_start included)
+ * @param[in] x_end End index on x-axis (x_end not included)
+ * @param[in] y_end End index on y-axis (y_end not included)
+ * @param[in] color_data Color data, same format as draw_bitmap
+ * @param[in] callback Callback to invoke when the draw has completed
+ * @param[in] user_ctx User context passed to @param callback
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if draw done callbacks have not been
+ *                                  enabled via
+ *                                  esp_lcd_ili9488_register_draw_done_callback
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_draw_bitmap_with_cb(
+    esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end,
+    int y_end, const void *color_data,
+    esp_lcd_ili9488_draw_done_cb_t callback, void *user_ctx);
+
+/**
+ * @brief Wait for all queued color data to be sent to the display.
+ *
+ * This can be used before reusing a color data buffer or changing the display
+ * configuration while draws are still in progress.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] timeout_ms Maximum time to wait
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_TIMEOUT       if the transfers did not complete in time
+ *          - ESP_OK                on success
+ *
+ * NOTE: @param timeout_ms is only used when draw done callbacks have been
+ * enabled, otherwise this blocks until all transfers have completed.
+ */
+esp_err_t esp_lcd_ili9488_wait_idle(esp_lcd_panel_handle_t panel,
+                                    uint32_t timeout_ms);
+
+/**
+ * @brief Start a task which performs all draws of the ILI9488 panel.
+ *
+ * Once started, draw_bitmap, esp_lcd_ili9488_draw_bitmap_with_cb,
+ * esp_lcd_ili9488_draw_bitmap_rgb666, esp_lcd_ili9488_draw_bitmaps and
+ * esp_lcd_ili9488_fill_rect can be called from any number of tasks. Each call
+ * is added to a lock-free queue and executed by the draw task, the calling
+ * task waits until the draw has been executed. This keeps the address window
+ * and color data of each draw together on the bus and the color conversion
+ * buffers are only used by the draw task. Draws are executed in the order
+ * they have been queued, when the queue is full the calling task blocks until
+ * the draw task has removed a draw from it.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] config Draw task configuration, NULL for a queue of 16 draws and
+ * a 4kB stack at priority 5 without core affinity
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if the draw task is already running
+ *          - ESP_ERR_NO_MEM        if out of memory
+ *          - ESP_OK                on success
+ *
+ * NOTE: The other panel functions which send commands or change the panel
+ * configuration (reset, init, mirror, swap_xy, set_gap, invert_color,
+ * disp_on_off, scrolling, partial mode and
+ * esp_lcd_ili9488_register_draw_done_callback) are passed to the draw task in
+ * the same way and are executed in order with the draws. The draw task is
+ * stopped when the panel is deleted. When the panel is deleted by a draw done
+ * callback running on the draw task, the draw task releases the panel once
+ * the current draw has completed and discards the draws still queued.
+ */
+esp_err_t esp_lcd_ili9488_start_draw_task(
+    esp_lcd_panel_handle_t panel,
+    const esp_lcd_ili9488_draw_task_config_t *config);
+
+/**
+ * @brief Queue a draw for the draw task without waiting for it.
+ *
+ * The color data must remain valid until @param callback has been invoked.
+ * When draw done callbacks have been enabled the callback is invoked once all
+ * color data has been sent. Otherwise it is invoked from the draw task once
+ * the color data is no longer used: in 18-bit and 3-bit color mode after it
+ * has been converted, in 16-bit color mode after the draw task has waited for
+ * it to be sent. The callback is also invoked when the draw fails.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[in] x_start Start index on x-axis (x_start included)
+ * @param[in] y_start Start index on y-axis (y_start included)
+ * @param[in] x_end End index on x-axis (x_end not included)
+ * @param[in] y_end End index on y-axis (y_end not included)
+ * @param[in] color_data Color data, same format as draw_bitmap
+ * @param[in] callback Callback to invoke when the draw has completed, may be
+ * NULL
+ * @param[in] user_ctx User context passed to @param callback
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if the draw task has not been started
+ *          - ESP_ERR_NO_MEM        if the draw queue is full
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_submit_draw(
+    esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end,
+    int y_end, const void *color_data,
+    esp_lcd_ili9488_draw_done_cb_t callback, void *user_ctx);
+
+/**
+ * @brief Retrieve the bus statistics and performance counters of the ILI9488
+ * panel.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[out] stats Receives a copy of the current statistics
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NOT_SUPPORTED if CONFIG_ILI9488_ENABLE_STATS is disabled
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_get_stats(esp_lcd_panel_handle_t panel,
+                                    esp_lcd_ili9488_stats_t *stats);
+
+/**
+ * @brief Reset the bus statistics of the ILI9488 panel to zero.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NOT_SUPPORTED if CONFIG_ILI9488_ENABLE_STATS is disabled
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_reset_stats(esp_lcd_panel_handle_t panel);
+
+/**
+ * @brief Retrieve the time it took to show the first frame on the ILI9488.
+ *
+ * The time is measured from the reset of the display until the display has
+ * been turned on and the first frame has been queued for transfer. It records
+ * when the commands were queued with the panel IO, not when they reached the
+ * display, so it does not include the time needed to send the first frame.
+ * The configuration commands sent by esp_lcd_panel_init do not add any delay,
+ * the only waits are the ones required by the datasheet before Sleep Out and
+ * Display On.
+ *
+ * @param[in] panel LCD panel handle created by esp_lcd_new_panel_ili9488
+ * @param[out] startup_time_us Receives the startup time in microseconds
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_INVALID_STATE if the first frame has not been shown yet
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_get_startup_time(esp_lcd_panel_handle_t panel,
+                                           uint32_t *startup_time_us);
+
+/**
+ * @brief Write the trace events recorded by all ILI9488 panels to a stream.
+ *
+ * Each event is written as a single line in the format
+ * "ili9488-trace <timestamp_us> <panel> <phase> <event> <value>", where phase
+ * is B / E for the begin and end of a duration and i for an instant event.
+ * The output can be converted to the Chrome trace event format using
+ * tools/ili9488_trace.py. Events remain in the trace buffer until they are
+ * overwritten by newer events or esp_lcd_ili9488_clear_trace is called.
+ *
+ * @param[in] stream Stream to write the events to, for example stdout
+ * @return
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NOT_SUPPORTED if CONFIG_ILI9488_ENABLE_TRACE is disabled
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_dump_trace(FILE *stream);
+
+/**
+ * @brief Discard the trace events recorded by all ILI9488 panels.
+ *
+ * @return
+ *          - ESP_ERR_NOT_SUPPORTED if CONFIG_ILI9488_ENABLE_TRACE is disabled
+ *          - ESP_OK                on success
+ */
+esp_err_t esp_lcd_ili9488_clear_trace(void);
+
 #ifdef __cplusplus
 }
 #endif
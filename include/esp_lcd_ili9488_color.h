@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Color conversion routines used by the ILI9488 driver in 18-bit color mode.
+ *
+ * These produce RGB666 color data as used by the ILI9488, each pixel is three
+ * bytes (red, green, blue) with the color in the upper six bits of each byte.
+ * The output can be passed to esp_lcd_ili9488_draw_bitmap_rgb666 directly.
+ *
+ * These routines do not depend on any ESP-IDF APIs and can be built for the
+ * host (linux target) for benchmarking.
+ *
+ * NOTE: @param buf must be large enough to hold @param pixels * 3 bytes. It
+ * does not need to be aligned, although the conversion is fastest when it is
+ * 32-bit aligned.
+ */
+
+/**
+ * @brief Convert RGB565 color data (native-endian uint16_t) to RGB666.
+ *
+ * @param[out] buf Buffer to receive the RGB666 color data.
+ * @param[in] color_data RGB565 color data, must be 16-bit aligned.
+ * @param[in] pixels Number of pixels to convert.
+ */
+void esp_lcd_ili9488_rgb565_to_rgb666(uint8_t *buf, const void *color_data,
+                                      size_t pixels);
+
+/**
+ * @brief Convert RGB565 color data with the two bytes of each pixel swapped
+ * (big-endian, as used by CONFIG_LV_COLOR_16_SWAP) to RGB666.
+ *
+ * @param[out] buf Buffer to receive the RGB666 color data.
+ * @param[in] color_data RGB565 color data, must be 16-bit aligned.
+ * @param[in] pixels Number of pixels to convert.
+ */
+void esp_lcd_ili9488_rgb565_swapped_to_rgb666(uint8_t *buf,
+                                              const void *color_data,
+                                              size_t pixels);
+
+/**
+ * @brief Convert packed RGB888 color data, stored in memory as blue, green,
+ * red bytes (little-endian 0xRRGGBB), to RGB666.
+ *
+ * @param[out] buf Buffer to receive the RGB666 color data.
+ * @param[in] color_data RGB888 color data.
+ * @param[in] pixels Number of pixels to convert.
+ */
+void esp_lcd_ili9488_rgb888_to_rgb666(uint8_t *buf, const void *color_data,
+                                      size_t pixels);
+
+/**
+ * @brief Convert XRGB8888 color data (native-endian 0xXXRRGGBB) to RGB666,
+ * the upper byte of each pixel is ignored.
+ *
+ * @param[out] buf Buffer to receive the RGB666 color data.
+ * @param[in] color_data XRGB8888 color data, must be 32-bit aligned.
+ * @param[in] pixels Number of pixels to convert.
+ */
+void esp_lcd_ili9488_xrgb8888_to_rgb666(uint8_t *buf, const void *color_data,
+                                        size_t pixels);
+
+/**
+ * Color conversion routines used by the ILI9488 driver in 3-bit color mode.
+ *
+ * These produce 3-bit color data as used by the ILI9488, each byte holds two
+ * pixels with the first pixel in bits 5..3 and the second in bits 2..0, the
+ * most significant bit of each color component is used.
+ *
+ * NOTE: @param buf must be large enough to hold (@param pixels + 1) / 2
+ * bytes. It does not need to be aligned, although the conversion is fastest
+ * when it is 32-bit aligned.
+ */
+
+/**
+ * @brief Convert RGB565 color data (native-endian uint16_t) to 3-bit color.
+ *
+ * @param[out] buf Buffer to receive the 3-bit color data.
+ * @param[in] color_data RGB565 color data, must be 16-bit aligned.
+ * @param[in] pixels Number of pixels to convert.
+ */
+void esp_lcd_ili9488_rgb565_to_rgb111(uint8_t *buf, const void *color_data,
+                                      size_t pixels);
+
+/**
+ * @brief Convert RGB565 color data with the two bytes of each pixel swapped
+ * (big-endian, as used by CONFIG_LV_COLOR_16_SWAP) to 3-bit color.
+ *
+ * @param[out] buf Buffer to receive the 3-bit color data.
+ * @param[in] color_data RGB565 color data, must be 16-bit aligned.
+ * @param[in] pixels Number of pixels to convert.
+ */
+void esp_lcd_ili9488_rgb565_swapped_to_rgb111(uint8_t *buf,
+                                              const void *color_data,
+                                              size_t pixels);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# SPDX-FileCopyrightText: 2022 atanisoft (github.com/atanisoft)
+#
+# SPDX-License-Identifier: MIT
+#
+
+"""Convert the output of esp_lcd_ili9488_dump_trace to Chrome trace JSON.
+
+The input can be a complete device log (for example captured via
+`idf.py monitor`), only lines starting with "ili9488-trace" are used. The
+resulting file can be opened in https://ui.perfetto.dev or chrome://tracing.
+
+    python ili9488_trace.py monitor.log -o trace.json
+"""
+
+import argparse
+import json
+import re
+import sys
+
+TRACE_LINE = re.compile(
+    r'ili9488-trace (\d+) (\d+) ([BEi]) (\w+) (\d+)')
+
+
+def parse_events(lines):
+    """Yield the trace events from the given lines with unwrapped timestamps.
+
+    The device records the lower 32 bits of the timestamp in microseconds,
+    they wrap after roughly 71 minutes.
+    """
+    offset = 0
+    previous = None
+    for line in lines:
+        match = TRACE_LINE.search(line)
+        if not match:
+            continue
+        timestamp = int(match.group(1))
+        if previous is not None and timestamp + offset + (1 << 31) < previous:
+            offset += 1 << 32
+        timestamp += offset
+        previous = timestamp
+        event = {
+            'name': match.group(4),
+            'ph': match.group(3),
+            'ts': timestamp,
+            'pid': 0,
+            'tid': int(match.group(2)),
+            'args': {'value': int(match.group(5))},
+        }
+        if event['ph'] == 'i':
+            event['s'] = 't'
+        yield event
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin,
+                        help='log containing the trace (default: stdin)')
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'),
+                        default=sys.stdout,
+                        help='Chrome trace JSON file (default: stdout)')
+    args = parser.parse_args()
+
+    events = list(parse_events(args.input))
+    metadata = [{
+        'name': 'thread_name',
+        'ph': 'M',
+        'pid': 0,
+        'tid': tid,
+        'args': {'name': 'ili9488 panel {}'.format(tid)},
+    } for tid in sorted({event['tid'] for event in events})]
+    json.dump({'traceEvents': metadata + events,
+               'displayTimeUnit': 'ms'}, args.output)
+    if args.output is not sys.stdout:
+        args.output.close()
+    print('{} trace events converted'.format(len(events)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()